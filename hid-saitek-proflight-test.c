@@ -0,0 +1,819 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * KUnit tests and microbenchmarks for the HID driver for Saitek Pro Flight
+ * series devices: display parsing and formatting, and input report decoding.
+ *
+ * A module of its own, built with 'make KUNIT=1' for a kernel with KUnit. It
+ * includes hid-saitek-proflight.c, so that the static functions can be called
+ * directly; that copy of the driver is never registered. Run with e.g.:
+ *   insmod hid-saitek-proflight-test.ko
+ *   cat /sys/kernel/debug/kunit/saitek_proflight/results
+ *
+ * Copyright (c) 2020 Paweł A. Ryszawa
+ */
+
+#define SAITEK_PROFLIGHT_KUNIT_TEST
+#include "hid-saitek-proflight.c"
+
+#include <kunit/test.h>
+
+#define SAITEK_BENCH_LOOPS 100000
+
+#define N PROFLIGHT_PANEL_DIGIT_NULL
+#define M PROFLIGHT_PANEL_DIGIT_MINUS
+#define D(x) ((char)((x) | PROFLIGHT_PANEL_DIGIT_DOT))
+
+/*
+ * Panel data as probe() would set it up, without a device behind it: the
+ * decoders and the parse/format functions only need the locks, the limits
+ * and a name to log with.
+ */
+struct saitek_test_panel {
+        struct hid_device hdev;
+        struct hid_report report; // ID 0, input: the one the panels send
+        struct saitek_proflight_alloc alloc;
+};
+
+static struct proflight *saitek_test_alloc(struct kunit *test, __u32 product_id)
+{
+        struct saitek_test_panel *p;
+        struct proflight *driver_data;
+
+        p = kunit_kzalloc(test, sizeof(*p), GFP_KERNEL);
+        KUNIT_ASSERT_NOT_NULL(test, p);
+        p->hdev.dev.init_name = "saitek-proflight-kunit";
+        p->hdev.product = product_id;
+        driver_data = &p->alloc.driver_data;
+        driver_data->hdev = &p->hdev;
+        driver_data->product_id = product_id;
+        driver_data->lock = &p->alloc.lock;
+        SAITEK_INIT_LOCK(driver_data->lock);
+        SAITEK_INIT_INPUT_LOCK(&driver_data->input_lock);
+        SAITEK_INIT_OUTPUT_LOCK(&driver_data->output_lock);
+        INIT_DELAYED_WORK(&driver_data->debounce_work, saitek_proflight_debounce_work);
+        switch (product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                driver_data->data.radiopanel = &p->alloc.panel.radiopanel;
+                driver_data->data.radiopanel->parent = driver_data;
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                driver_data->data.multipanel = &p->alloc.panel.multipanel;
+                driver_data->data.multipanel->parent = driver_data;
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                driver_data->data.switchpanel = &p->alloc.panel.switchpanel;
+                driver_data->data.switchpanel->parent = driver_data;
+                break;
+        }
+        saitek_proflight_init_limits(driver_data);
+        saitek_proflight_blank(driver_data);
+        test->priv = driver_data;
+
+        return driver_data;
+}
+
+static struct hid_report *saitek_test_report(struct proflight *driver_data)
+{
+        return &container_of(driver_data, struct saitek_test_panel, alloc.driver_data)->report;
+}
+
+/*
+ * Decodes a report through the panel's raw event handler, a second after
+ * the previous one so that no change is held back by the debouncer.
+ */
+static int saitek_test_decode(struct proflight *driver_data, __u32 bits, int size)
+{
+        struct hid_report *report = saitek_test_report(driver_data);
+        u8 data[PROFLIGHT_INPUT_REPORT_LEN] = { bits, bits >> 8, bits >> 16 };
+        unsigned long flags;
+        int res = 0;
+
+        SAITEK_INPUT_WRITE_BEGIN(&driver_data->input_lock, flags);
+        driver_data->nevents = 0;
+        driver_data->event_time_ns += NSEC_PER_SEC;
+        switch (driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                res = saitek_proflight_radiopanel_raw_event(driver_data->data.radiopanel,
+                                driver_data->hdev, report, data, size);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                res = saitek_proflight_multipanel_raw_event(driver_data->data.multipanel,
+                                driver_data->hdev, report, data, size);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                res = saitek_proflight_switchpanel_raw_event(driver_data->data.switchpanel,
+                                driver_data->hdev, report, data, size);
+                break;
+        }
+        SAITEK_INPUT_WRITE_END(&driver_data->input_lock, flags);
+
+        return res;
+}
+
+static void saitek_test_expect_event(struct kunit *test, struct proflight *driver_data,
+                int i, __u16 type, __u16 code, __s32 value)
+{
+        KUNIT_ASSERT_LT(test, i, driver_data->nevents);
+        KUNIT_EXPECT_EQ(test, driver_data->events[i].type, type);
+        KUNIT_EXPECT_EQ(test, driver_data->events[i].code, code);
+        KUNIT_EXPECT_EQ(test, driver_data->events[i].value, value);
+        KUNIT_EXPECT_EQ(test, driver_data->events[i].time_ns, driver_data->event_time_ns);
+}
+
+static void saitek_test_exit(struct kunit *test)
+{
+        struct proflight *driver_data = test->priv;
+
+        if (driver_data)
+                cancel_delayed_work_sync(&driver_data->debounce_work);
+}
+
+struct saitek_display_case {
+        const char *text;
+        size_t size;
+        char display[5];
+};
+
+static const struct saitek_display_case saitek_radiopanel_parse_cases[] = {
+        { "12345", 5, { 1, 2, 3, 4, 5 } },
+        { "00000", 5, { 0, 0, 0, 0, 0 } },
+        { "118.00", 6, { 1, 1, D(8), 0, 0 } }, // the dot lights on the digit before it
+        { "1.2.3.4.5.", 10, { D(1), D(2), D(3), D(4), D(5) } },
+        { "12345.", 6, { 1, 2, 3, 4, D(5) } }, // a dot right after the 5th digit
+        { "12345.", 5, { 1, 2, 3, 4, 5 } }, // ... unless the buffer ends before it
+        { ".1234", 5, { D(N), 1, 2, 3, 4 } }, // a leading dot takes a blank digit
+        { "1..2", 4, { D(1), 2, N, N, N } }, // a second dot changes nothing
+        { "  1.5", 5, { N, N, D(1), 5, N } }, // short text is padded with blanks
+        { "1a-3", 4, { 1, N, N, 3, N } }, // anything else is a blank
+        { "", 0, { N, N, N, N, N } },
+        { "123456", 3, { 1, 2, 3, N, N } }, // no more than size characters
+        { "123.45    ", 10, { 1, 2, D(3), 4, 5 } }, // a field of the proflight attribute
+        { "108.95   7", 10, { 1, 0, D(8), 9, 5 } }, // only the first 5 digits count
+};
+
+static void saitek_test_parse_radiopanel_display(struct kunit *test)
+{
+        const struct saitek_display_case *c;
+        char display[5];
+        int i;
+
+        for (i = 0; i < ARRAY_SIZE(saitek_radiopanel_parse_cases); i++) {
+                c = &saitek_radiopanel_parse_cases[i];
+                memset(display, 0x55, sizeof(display));
+                saitek_parse_radiopanel_display(display, c->text, c->size);
+                KUNIT_EXPECT_MEMEQ_MSG(test, display, c->display, sizeof(display),
+                                "'%.*s'", (int)c->size, c->text);
+        }
+}
+
+static const struct saitek_display_case saitek_radiopanel_format_cases[] = {
+        { "12345", 10, { 1, 2, 3, 4, 5 } },
+        { "118.00", 10, { 1, 1, D(8), 0, 0 } },
+        { "1.2.3.4.5.", 10, { D(1), D(2), D(3), D(4), D(5) } },
+        { " .1234", 10, { D(N), 1, 2, 3, 4 } },
+        { "     ", 10, { N, N, N, N, N } },
+        { "?1234", 10, { M, 1, 2, 3, 4 } }, // no minus sign on the Radio Panel
+        { "?? 9?", 10, { 10, 13, N, 9, 0x3a } }, // nor other digit codes
+        { "123", 3, { 1, 2, 3, 4, 5 } }, // no more than size characters
+        { "12.", 3, { 1, D(2), 3, 4, 5 } },
+};
+
+static void saitek_test_format_radiopanel_display(struct kunit *test)
+{
+        const struct saitek_display_case *c;
+        char buf[11];
+        int i, len;
+
+        for (i = 0; i < ARRAY_SIZE(saitek_radiopanel_format_cases); i++) {
+                c = &saitek_radiopanel_format_cases[i];
+                memset(buf, 0, sizeof(buf));
+                len = saitek_format_radiopanel_display(buf, c->display, c->size);
+                KUNIT_EXPECT_STREQ(test, buf, c->text);
+                KUNIT_EXPECT_EQ(test, len, (int)strlen(c->text));
+        }
+}
+
+/*
+ * Parsing what was formatted gives the same digits, wherever the dot is.
+ */
+static void saitek_test_radiopanel_display_roundtrip(struct kunit *test)
+{
+        char display[5], parsed[5], buf[11];
+        int digits, dot, i, len, v;
+
+        for (digits = 0; digits < 100000; digits += 7919) {
+                for (dot = -1; dot < 5; dot++) {
+                        for (i = 4, v = digits; i >= 0; i--, v /= 10)
+                                display[i] = v % 10;
+                        if (dot >= 0)
+                                display[dot] |= PROFLIGHT_PANEL_DIGIT_DOT;
+                        len = saitek_format_radiopanel_display(buf, display, 10);
+                        KUNIT_EXPECT_EQ(test, len, dot >= 0 ? 6 : 5);
+                        saitek_parse_radiopanel_display(parsed, buf, len);
+                        KUNIT_EXPECT_MEMEQ(test, parsed, display, sizeof(display));
+                }
+        }
+}
+
+static const struct saitek_display_case saitek_multipanel_parse_cases[] = {
+        { "12345", 5, { 1, 2, 3, 4, 5 } },
+        { "-1200", 5, { M, 1, 2, 0, 0 } },
+        { " 12x4", 5, { N, 1, 2, N, 4 } },
+        { "1.234", 5, { 1, N, 2, 3, 4 } }, // no dots on the Multi Panel
+        { "123456", 5, { 1, 2, 3, 4, 5 } },
+        { "12", 2, { 1, 2, 7, 7, 7 } }, // short text leaves the rest as it was
+        { "", 0, { 7, 7, 7, 7, 7 } },
+};
+
+static void saitek_test_parse_multipanel_display(struct kunit *test)
+{
+        const struct saitek_display_case *c;
+        char display[5];
+        int i;
+
+        for (i = 0; i < ARRAY_SIZE(saitek_multipanel_parse_cases); i++) {
+                c = &saitek_multipanel_parse_cases[i];
+                memset(display, 7, sizeof(display));
+                saitek_parse_multipanel_display(display, c->text, c->size);
+                KUNIT_EXPECT_MEMEQ_MSG(test, display, c->display, sizeof(display),
+                                "'%.*s'", (int)c->size, c->text);
+        }
+}
+
+static const struct saitek_display_case saitek_multipanel_format_cases[] = {
+        { "12345", 5, { 1, 2, 3, 4, 5 } },
+        { "-01 9", 5, { M, 0, 1, N, 9 } },
+        { "     ", 5, { N, N, N, N, N } },
+        { "  0  ", 5, { 10, D(1), 0, 0x7f, 0x40 } }, // unknown codes show blank
+        { "12", 2, { 1, 2, 3, 4, 5 } },
+};
+
+static void saitek_test_format_multipanel_display(struct kunit *test)
+{
+        const struct saitek_display_case *c;
+        char buf[6];
+        int i;
+
+        for (i = 0; i < ARRAY_SIZE(saitek_multipanel_format_cases); i++) {
+                c = &saitek_multipanel_format_cases[i];
+                memset(buf, 0, sizeof(buf));
+                saitek_format_multipanel_display(buf, c->display, c->size);
+                KUNIT_EXPECT_STREQ(test, buf, c->text);
+        }
+}
+
+#define SAITEK_TEST_RADIOPANEL_TEXT \
+        "118.00    " " " "118.95    " " " "108.50    " " " "113.90    " " " "R"
+
+static void saitek_test_buf_parse_radiopanel(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL);
+        struct proflight_radiopanel *radiopanel = driver_data->data.radiopanel;
+        const char text[] = SAITEK_TEST_RADIOPANEL_TEXT;
+        char blank[5] = { N, N, N, N, N };
+
+        driver_data->mode = 'N';
+        // too short: nothing changes
+        saitek_buf_parse_radiopanel(radiopanel, text, sizeof(text) - 2);
+        KUNIT_EXPECT_MEMEQ(test, radiopanel->display0l, blank, 5);
+        KUNIT_EXPECT_EQ(test, driver_data->mode, 'N');
+
+        saitek_buf_parse_radiopanel(radiopanel, text, sizeof(text) - 1);
+        KUNIT_EXPECT_MEMEQ(test, radiopanel->display0l, ((char []){ 1, 1, D(8), 0, 0 }), 5);
+        KUNIT_EXPECT_MEMEQ(test, radiopanel->display0r, ((char []){ 1, 1, D(8), 9, 5 }), 5);
+        KUNIT_EXPECT_MEMEQ(test, radiopanel->display1l, ((char []){ 1, 0, D(8), 5, 0 }), 5);
+        KUNIT_EXPECT_MEMEQ(test, radiopanel->display1r, ((char []){ 1, 1, D(3), 9, 0 }), 5);
+        KUNIT_EXPECT_EQ(test, driver_data->mode, 'R');
+
+        // a mode other than 'N' or 'R' leaves it as it was
+        saitek_buf_parse_radiopanel(radiopanel,
+                        "          " " " "          " " " "          " " " "1.2.3.4.5." " " "x", 45);
+        KUNIT_EXPECT_MEMEQ(test, radiopanel->display0l, blank, 5);
+        KUNIT_EXPECT_MEMEQ(test, radiopanel->display1r, ((char []){ D(1), D(2), D(3), D(4), D(5) }), 5);
+        KUNIT_EXPECT_EQ(test, driver_data->mode, 'R');
+}
+
+static void saitek_test_buf_parse_multipanel(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL);
+        struct proflight_multipanel *multipanel = driver_data->data.multipanel;
+
+        driver_data->mode = 'R';
+        saitek_buf_parse_multipanel(multipanel, "12345 -0500 10101010 N", 21); // too short
+        KUNIT_EXPECT_MEMEQ(test, multipanel->display0, ((char []){ N, N, N, N, N }), 5);
+
+        saitek_buf_parse_multipanel(multipanel, "12345 -0500 10101010 N", 22);
+        KUNIT_EXPECT_MEMEQ(test, multipanel->display0, ((char []){ 1, 2, 3, 4, 5 }), 5);
+        KUNIT_EXPECT_MEMEQ(test, multipanel->display1, ((char []){ M, 0, 5, 0, 0 }), 5);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_hdg, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_nav, 0);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_ias, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_alt, 0);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_vs, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_apr, 0);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_rev, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_ap, 0);
+        KUNIT_EXPECT_EQ(test, driver_data->mode, 'N');
+
+        // lights other than '0' or '1' and an unknown mode stay as they were
+        saitek_buf_parse_multipanel(multipanel, "  -1 " " " "   2 " " " "x1x0x1x0" " " "?", 22);
+        KUNIT_EXPECT_MEMEQ(test, multipanel->display0, ((char []){ N, N, M, 1, N }), 5);
+        KUNIT_EXPECT_MEMEQ(test, multipanel->display1, ((char []){ N, N, N, 2, N }), 5);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_hdg, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_nav, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_ias, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_alt, 0);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_vs, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_apr, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_rev, 1);
+        KUNIT_EXPECT_EQ(test, (int)multipanel->led_ap, 0);
+        KUNIT_EXPECT_EQ(test, driver_data->mode, 'N');
+}
+
+static void saitek_test_buf_parse_switchpanel(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL);
+        struct proflight_switchpanel *switchpanel = driver_data->data.switchpanel;
+        __u8 report[SAITEK_HID_BUF_LEN];
+
+        saitek_buf_parse_switchpanel(switchpanel, "GR", 2); // too short
+        KUNIT_EXPECT_EQ(test, switchpanel->led_n, 0);
+
+        saitek_buf_parse_switchpanel(switchpanel, "GRY", 3);
+        KUNIT_EXPECT_EQ(test, switchpanel->led_n, 'G');
+        KUNIT_EXPECT_EQ(test, switchpanel->led_l, 'R');
+        KUNIT_EXPECT_EQ(test, switchpanel->led_r, 'Y');
+        KUNIT_EXPECT_EQ(test, saitek_fill_switchpanel_report(switchpanel, report), 2);
+        KUNIT_EXPECT_EQ(test, report[1],
+                        PROFLIGHT_SWITCHPANEL_LIGHT_N_GREEN |
+                        PROFLIGHT_SWITCHPANEL_LIGHT_L_RED |
+                        PROFLIGHT_SWITCHPANEL_LIGHT_R_GREEN |
+                        PROFLIGHT_SWITCHPANEL_LIGHT_R_RED);
+
+        // '-' turns a light off, anything else leaves it as it was
+        saitek_buf_parse_switchpanel(switchpanel, "-x-", 3);
+        KUNIT_EXPECT_EQ(test, switchpanel->led_n, 0);
+        KUNIT_EXPECT_EQ(test, switchpanel->led_l, 'R');
+        KUNIT_EXPECT_EQ(test, switchpanel->led_r, 0);
+        saitek_fill_switchpanel_report(switchpanel, report);
+        KUNIT_EXPECT_EQ(test, report[1], PROFLIGHT_SWITCHPANEL_LIGHT_L_RED);
+}
+
+static void saitek_test_buf_format_radiopanel(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL);
+        struct proflight_radiopanel *radiopanel = driver_data->data.radiopanel;
+        const char expected[] = "[RP] 118.00     118.95     108.50     113.90     R "
+                        "1 3 -05  12 COM1 0 0  00  00 NAV1";
+        char *buf;
+
+        buf = kunit_kzalloc(test, MAX_BUFFER, GFP_KERNEL);
+        KUNIT_ASSERT_NOT_NULL(test, buf);
+        saitek_buf_parse_radiopanel(radiopanel, SAITEK_TEST_RADIOPANEL_TEXT, 45);
+        radiopanel->bits = 1 << PROFLIGHT_RP_ACTSTBY0;
+        radiopanel->mode0 = PROFLIGHT_RADIOPANEL_MODE_COM1;
+        radiopanel->mode1 = PROFLIGHT_RADIOPANEL_MODE_NAV1;
+        atomic_set(&radiopanel->aactstby0, 3);
+        atomic_set(&radiopanel->innerknob0, -5);
+        atomic_set(&radiopanel->outerknob0, 12);
+        KUNIT_EXPECT_EQ(test, saitek_buf_format_radiopanel(buf, radiopanel), (int)strlen(expected));
+        KUNIT_EXPECT_STREQ(test, buf, expected);
+}
+
+static void saitek_test_buf_format_multipanel(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL);
+        struct proflight_multipanel *multipanel = driver_data->data.multipanel;
+        const char first[] = "[MP] 12345 -0500 10101010 N 10000001 1 +02 -03 +00 "
+                        "0 0 0 0 0 0 0 1 HDG\n";
+        char *buf;
+        int len;
+
+        buf = kunit_kzalloc(test, MAX_BUFFER, GFP_KERNEL);
+        KUNIT_ASSERT_NOT_NULL(test, buf);
+        saitek_buf_parse_multipanel(multipanel, "12345 -0500 10101010 N", 22);
+        multipanel->bits = 1 << PROFLIGHT_MP_AP | 1 << PROFLIGHT_MP_HDG
+                        | 1 << PROFLIGHT_MP_AUTO_THROTTLE;
+        multipanel->mode = PROFLIGHT_MULTIPANEL_MODE_HDG;
+        atomic_set(&multipanel->aap, 1);
+        atomic_set(&multipanel->flaps, 2);
+        atomic_set(&multipanel->pitch_trim, -3);
+        len = saitek_buf_format_multipanel(buf, multipanel);
+        KUNIT_EXPECT_EQ(test, len, (int)strlen(buf));
+        KUNIT_EXPECT_EQ(test, strncmp(buf, first, strlen(first)), 0);
+        KUNIT_EXPECT_NOT_NULL(test, strstr(buf, "\nMODE:HDG\nHDG:ON  (0)\nNAV:OFF (0)\n"));
+        KUNIT_EXPECT_NOT_NULL(test, strstr(buf, "\nAP:ON  (1)\nAUTO-THROTTLE:ON \n"));
+        KUNIT_EXPECT_NOT_NULL(test, strstr(buf, "\nFLAPS:  2\nPITCH-TRIM: -3\nKNOB:  0"));
+}
+
+static void saitek_test_buf_format_switchpanel(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL);
+        struct proflight_switchpanel *switchpanel = driver_data->data.switchpanel;
+        char *buf;
+
+        buf = kunit_kzalloc(test, MAX_BUFFER, GFP_KERNEL);
+        KUNIT_ASSERT_NOT_NULL(test, buf);
+        saitek_buf_parse_switchpanel(switchpanel, "GR-", 3);
+        switchpanel->mode = PROFLIGHT_SWITCHPANEL_MODE_LEFT;
+        switchpanel->bits = 1 << PROFLIGHT_SP_MASTER_BAT | 1 << PROFLIGHT_SP_LANDING
+                        | 1 << PROFLIGHT_SP_GEAR_DOWN;
+        saitek_buf_format_switchpanel(buf, switchpanel);
+        KUNIT_EXPECT_STREQ(test, buf, "[MP] GR- LEFT  1000000000001 D");
+
+        switchpanel->bits = 1 << PROFLIGHT_SP_GEAR_UP;
+        switchpanel->mode = 0;
+        saitek_buf_format_switchpanel(buf, switchpanel);
+        KUNIT_EXPECT_STREQ(test, buf, "[MP] GR-       0000000000000 U");
+}
+
+static void saitek_test_radiopanel_decode(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL);
+        struct proflight_radiopanel *radiopanel = driver_data->data.radiopanel;
+        __u32 rest = 1 << 0 | 1 << 9; // COM1 upper, NAV1 lower
+
+        KUNIT_EXPECT_EQ(test, saitek_test_decode(driver_data, rest, 3), 1);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 2);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_SEL, PROFLIGHT_SEL_0,
+                        PROFLIGHT_RADIOPANEL_MODE_COM1);
+        saitek_test_expect_event(test, driver_data, 1, PROFLIGHT_EV_SEL, PROFLIGHT_SEL_1,
+                        PROFLIGHT_RADIOPANEL_MODE_NAV1);
+        KUNIT_EXPECT_EQ(test, radiopanel->mode0, PROFLIGHT_RADIOPANEL_MODE_COM1);
+        KUNIT_EXPECT_EQ(test, radiopanel->mode1, PROFLIGHT_RADIOPANEL_MODE_NAV1);
+
+        // the same report again changes nothing
+        saitek_test_decode(driver_data, rest, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 0);
+
+        // every position of both selectors
+        saitek_test_decode(driver_data, 1 << 6 | 1 << 13, 3);
+        KUNIT_EXPECT_EQ(test, radiopanel->mode0, PROFLIGHT_RADIOPANEL_MODE_XPDR);
+        KUNIT_EXPECT_EQ(test, radiopanel->mode1, PROFLIGHT_RADIOPANEL_MODE_XPDR);
+        saitek_test_decode(driver_data, 1 << 4 | 1 << 12, 3);
+        KUNIT_EXPECT_EQ(test, radiopanel->mode0, PROFLIGHT_RADIOPANEL_MODE_ADF);
+        KUNIT_EXPECT_EQ(test, radiopanel->mode1, PROFLIGHT_RADIOPANEL_MODE_DME);
+
+        // between two positions: the selector keeps the previous one
+        saitek_test_decode(driver_data, 1 << 12, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 0);
+        KUNIT_EXPECT_EQ(test, radiopanel->mode0, PROFLIGHT_RADIOPANEL_MODE_ADF);
+        KUNIT_EXPECT_EQ(test, atomic64_read(&driver_data->stats.glitches), 1);
+        saitek_test_decode(driver_data, rest, 3);
+
+        // ACT/STBY presses are counted, releases are not
+        saitek_test_decode(driver_data, rest | 1 << PROFLIGHT_RP_ACTSTBY0, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 1);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_KEY, PROFLIGHT_RP_ACTSTBY0, 1);
+        saitek_test_decode(driver_data, rest, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_KEY, PROFLIGHT_RP_ACTSTBY0, 0);
+        KUNIT_EXPECT_EQ(test, atomic_read(&radiopanel->aactstby0), 1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&radiopanel->aactstby1), 0);
+
+        // a detent is counted when its bit gets set, in the direction of the bit
+        saitek_test_decode(driver_data, rest | 1 << 16, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_REL, PROFLIGHT_RP_INNERKNOB0, 1);
+        saitek_test_decode(driver_data, rest, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 0);
+        saitek_test_decode(driver_data, rest | 1 << 23, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_REL, PROFLIGHT_RP_OUTERKNOB1, -1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&radiopanel->innerknob0), 1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&radiopanel->outerknob1), -1);
+
+        // at the end of the range the detent is reported, but not counted
+        atomic_set(&radiopanel->outerknob0, SAITEK_MAX_KNOB);
+        saitek_test_decode(driver_data, rest | 1 << 18, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_REL, PROFLIGHT_RP_OUTERKNOB0, 1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&radiopanel->outerknob0), SAITEK_MAX_KNOB);
+        KUNIT_EXPECT_EQ(test, atomic_read(&driver_data->saturated[PROFLIGHT_RP_OUTERKNOB0]), 1);
+
+        // short and foreign reports are not decoded
+        KUNIT_EXPECT_EQ(test, saitek_test_decode(driver_data, rest, 2), -1);
+        saitek_test_report(driver_data)->id = 1;
+        KUNIT_EXPECT_EQ(test, saitek_test_decode(driver_data, 0, 3), 0);
+        KUNIT_EXPECT_EQ(test, radiopanel->bits, rest | 1 << 23 | 1 << 18);
+}
+
+static void saitek_test_multipanel_decode(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL);
+        struct proflight_multipanel *multipanel = driver_data->data.multipanel;
+        __u32 rest = 1 << 0; // ALT
+
+        saitek_test_decode(driver_data, rest, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 1);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_SEL, PROFLIGHT_SEL_0,
+                        PROFLIGHT_MULTIPANEL_MODE_ALT);
+        saitek_test_decode(driver_data, 1 << 4, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_SEL, PROFLIGHT_SEL_0,
+                        PROFLIGHT_MULTIPANEL_MODE_CRS);
+        KUNIT_EXPECT_EQ(test, multipanel->mode, PROFLIGHT_MULTIPANEL_MODE_CRS);
+        saitek_test_decode(driver_data, rest, 3);
+
+        // changes in one report come out in bit order
+        saitek_test_decode(driver_data, rest | 1 << PROFLIGHT_MP_AP | 1 << PROFLIGHT_MP_HDG
+                        | 1 << PROFLIGHT_MP_AUTO_THROTTLE, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_KEY, PROFLIGHT_MP_AP, 1);
+        saitek_test_expect_event(test, driver_data, 1, PROFLIGHT_EV_KEY, PROFLIGHT_MP_HDG, 1);
+        saitek_test_expect_event(test, driver_data, 2, PROFLIGHT_EV_KEY,
+                        PROFLIGHT_MP_AUTO_THROTTLE, 1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&multipanel->aap), 1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&multipanel->ahdg), 1);
+        saitek_test_decode(driver_data, rest, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 3);
+
+        // knob and flaps: up bit first; pitch trim: down bit first
+        saitek_test_decode(driver_data, rest | 1 << 5, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_REL, PROFLIGHT_MP_KNOB, 1);
+        saitek_test_decode(driver_data, rest | 1 << 6, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_REL, PROFLIGHT_MP_KNOB, -1);
+        saitek_test_decode(driver_data, rest | 1 << 16, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_REL, PROFLIGHT_MP_FLAPS, 1);
+        saitek_test_decode(driver_data, rest | 1 << 19, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_REL, PROFLIGHT_MP_PITCH_TRIM, 1);
+        saitek_test_decode(driver_data, rest | 1 << 18, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_REL, PROFLIGHT_MP_PITCH_TRIM, -1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&multipanel->knob), 0);
+        KUNIT_EXPECT_EQ(test, atomic_read(&multipanel->flaps), 1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&multipanel->pitch_trim), 0);
+
+        // presses stop being counted at SAITEK_MAX_BTN
+        atomic_set(&multipanel->arev, SAITEK_MAX_BTN);
+        saitek_test_decode(driver_data, rest | 1 << PROFLIGHT_MP_REV, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_KEY, PROFLIGHT_MP_REV, 1);
+        KUNIT_EXPECT_EQ(test, atomic_read(&multipanel->arev), SAITEK_MAX_BTN);
+        KUNIT_EXPECT_EQ(test, atomic64_read(&driver_data->stats.clamps), 1);
+}
+
+static void saitek_test_switchpanel_decode(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL);
+        struct proflight_switchpanel *switchpanel = driver_data->data.switchpanel;
+        __u32 rest = 1 << 13; // OFF
+        int code;
+
+        saitek_test_decode(driver_data, rest, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_SEL, PROFLIGHT_SEL_0,
+                        PROFLIGHT_SWITCHPANEL_MODE_OFF);
+
+        // the key switch turned to START touches BOTH as well: START wins
+        saitek_test_decode(driver_data, 1 << 16 | 1 << 17, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 1);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_SEL, PROFLIGHT_SEL_0,
+                        PROFLIGHT_SWITCHPANEL_MODE_START);
+        saitek_test_decode(driver_data, 1 << 16, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_SEL, PROFLIGHT_SEL_0,
+                        PROFLIGHT_SWITCHPANEL_MODE_BOTH);
+        KUNIT_EXPECT_EQ(test, switchpanel->mode, PROFLIGHT_SWITCHPANEL_MODE_BOTH);
+        saitek_test_decode(driver_data, rest, 3);
+
+        // every switch, on and off
+        for (code = PROFLIGHT_SP_MASTER_BAT; code <= PROFLIGHT_SP_LANDING; code++) {
+                saitek_test_decode(driver_data, rest | 1 << code, 3);
+                KUNIT_EXPECT_EQ(test, driver_data->nevents, 1);
+                saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_KEY, code, 1);
+                KUNIT_EXPECT_EQ(test, SAITEK_BIT(switchpanel, code), 1);
+                saitek_test_decode(driver_data, rest, 3);
+                saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_KEY, code, 0);
+        }
+
+        // gear lever: up, then down
+        saitek_test_decode(driver_data, rest | 1 << PROFLIGHT_SP_GEAR_UP, 3);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_KEY, PROFLIGHT_SP_GEAR_UP, 1);
+        saitek_test_decode(driver_data, rest | 1 << PROFLIGHT_SP_GEAR_DOWN, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 2);
+        saitek_test_expect_event(test, driver_data, 0, PROFLIGHT_EV_KEY, PROFLIGHT_SP_GEAR_UP, 0);
+        saitek_test_expect_event(test, driver_data, 1, PROFLIGHT_EV_KEY, PROFLIGHT_SP_GEAR_DOWN, 1);
+}
+
+/*
+ * A change of a bit less than its debounce window after the previous one is
+ * held back, and taken once the window is over.
+ */
+static void saitek_test_debounce(struct kunit *test)
+{
+        struct proflight *driver_data = saitek_test_alloc(test,
+                        USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL);
+        __u32 rest = 1 << 13;
+
+        saitek_test_decode(driver_data, rest, 3);
+        saitek_test_decode(driver_data, rest | 1 << PROFLIGHT_SP_NAV, 3);
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 1);
+        if (!READ_ONCE(debounce_key_us))
+                kunit_skip(test, "debounce_key_us is 0");
+        driver_data->event_time_ns -= NSEC_PER_SEC; // right after the previous one
+        saitek_test_decode(driver_data, rest, 3);
+        // the debounce work re-evaluates it once the window is over: run it now
+        KUNIT_EXPECT_TRUE(test, cancel_delayed_work_sync(&driver_data->debounce_work));
+        KUNIT_EXPECT_EQ(test, driver_data->nevents, 0);
+        KUNIT_EXPECT_EQ(test, atomic64_read(&driver_data->stats.glitches), 1);
+        KUNIT_EXPECT_EQ(test, SAITEK_BIT(driver_data->data.switchpanel, PROFLIGHT_SP_NAV), 1);
+        saitek_proflight_debounce_work(&driver_data->debounce_work.work);
+        KUNIT_EXPECT_EQ(test, SAITEK_BIT(driver_data->data.switchpanel, PROFLIGHT_SP_NAV), 0);
+}
+
+/*
+ * Counters wrapped or clamped at their limits, also far outside the range and
+ * with a range of all 2^32 values.
+ */
+static void saitek_test_limit(struct kunit *test)
+{
+        struct saitek_limit wrap = { SAITEK_LIMIT_WRAP, 0, 359 };
+        struct saitek_limit full = { SAITEK_LIMIT_WRAP, INT_MIN, INT_MAX };
+        struct saitek_limit clamp = { SAITEK_LIMIT_CLAMP, -10, 10 };
+        atomic_t counter;
+
+        KUNIT_EXPECT_EQ(test, saitek_limit_apply(&wrap, 360), 0);
+        KUNIT_EXPECT_EQ(test, saitek_limit_apply(&wrap, -1), 359);
+        KUNIT_EXPECT_EQ(test, saitek_limit_apply(&wrap, 3 * 360 + 5), 5);
+        KUNIT_EXPECT_EQ(test, saitek_limit_apply(&wrap, -3 * 360 - 5), 355);
+        KUNIT_EXPECT_EQ(test, saitek_limit_apply(&full, (s64)INT_MAX + 1), INT_MIN);
+        KUNIT_EXPECT_EQ(test, saitek_limit_apply(&full, (s64)INT_MIN - 1), INT_MAX);
+        KUNIT_EXPECT_EQ(test, saitek_limit_apply(&clamp, 11), 10);
+        KUNIT_EXPECT_EQ(test, saitek_limit_apply(&clamp, INT_MIN), -10);
+
+        atomic_set(&counter, 358);
+        KUNIT_EXPECT_TRUE(test, saitek_counter_add(&counter, 5, &wrap));
+        KUNIT_EXPECT_EQ(test, atomic_read(&counter), 3);
+        atomic_set(&counter, 9);
+        KUNIT_EXPECT_FALSE(test, saitek_counter_add(&counter, 2, &clamp));
+        KUNIT_EXPECT_EQ(test, atomic_read(&counter), 10);
+        KUNIT_EXPECT_TRUE(test, saitek_counter_add(&counter, -2, &clamp));
+        KUNIT_EXPECT_EQ(test, atomic_read(&counter), 8);
+}
+
+/*
+ * What the driver module would register: the three panels, nothing else.
+ */
+static void saitek_test_driver(struct kunit *test)
+{
+        const struct hid_device_id *id = saitek_proflight_driver.id_table;
+
+        KUNIT_EXPECT_EQ(test, id[0].product, USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL);
+        KUNIT_EXPECT_EQ(test, id[1].product, USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL);
+        KUNIT_EXPECT_EQ(test, id[2].product, USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL);
+        KUNIT_EXPECT_EQ(test, id[0].vendor, USB_VENDOR_ID_SAITEK);
+        KUNIT_EXPECT_EQ(test, id[2].bus, BUS_USB);
+        KUNIT_EXPECT_EQ(test, id[3].vendor, 0);
+        KUNIT_EXPECT_TRUE(test, saitek_proflight_driver.raw_event == saitek_proflight_raw_event);
+}
+
+static void saitek_bench_report(struct kunit *test, const char *name, u64 start)
+{
+        kunit_info(test, "%s: %llu ns per call\n", name,
+                        div_u64(ktime_get_ns() - start, SAITEK_BENCH_LOOPS));
+}
+
+static void saitek_bench_display(struct kunit *test)
+{
+        char display[5] = { 1, 2, D(3), 4, 5 };
+        char buf[11];
+        u64 start;
+        int i;
+
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++) {
+                saitek_parse_radiopanel_display(display, "123.45    ", 10);
+                barrier_data(display);
+        }
+        saitek_bench_report(test, "saitek_parse_radiopanel_display", start);
+
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++) {
+                saitek_format_radiopanel_display(buf, display, 10);
+                barrier_data(buf);
+        }
+        saitek_bench_report(test, "saitek_format_radiopanel_display", start);
+
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++) {
+                saitek_parse_multipanel_display(display, "-1200", 5);
+                barrier_data(display);
+        }
+        saitek_bench_report(test, "saitek_parse_multipanel_display", start);
+
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++) {
+                saitek_format_multipanel_display(buf, display, 5);
+                barrier_data(buf);
+        }
+        saitek_bench_report(test, "saitek_format_multipanel_display", start);
+}
+
+static void saitek_bench_buf(struct kunit *test)
+{
+        struct proflight *radio = saitek_test_alloc(test, USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL);
+        struct proflight *multi = saitek_test_alloc(test, USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL);
+        struct proflight *sw = saitek_test_alloc(test, USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL);
+        u64 start;
+        char *buf;
+        int i;
+
+        buf = kunit_kzalloc(test, MAX_BUFFER, GFP_KERNEL);
+        KUNIT_ASSERT_NOT_NULL(test, buf);
+
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++)
+                saitek_buf_parse_radiopanel(radio->data.radiopanel, SAITEK_TEST_RADIOPANEL_TEXT, 45);
+        saitek_bench_report(test, "saitek_buf_parse_radiopanel", start);
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++)
+                saitek_buf_parse_multipanel(multi->data.multipanel, "12345 -0500 10101010 N", 22);
+        saitek_bench_report(test, "saitek_buf_parse_multipanel", start);
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++)
+                saitek_buf_parse_switchpanel(sw->data.switchpanel, "GRY", 3);
+        saitek_bench_report(test, "saitek_buf_parse_switchpanel", start);
+
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++)
+                saitek_buf_format_radiopanel(buf, radio->data.radiopanel);
+        saitek_bench_report(test, "saitek_buf_format_radiopanel", start);
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++)
+                saitek_buf_format_multipanel(buf, multi->data.multipanel);
+        saitek_bench_report(test, "saitek_buf_format_multipanel", start);
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++)
+                saitek_buf_format_switchpanel(buf, sw->data.switchpanel);
+        saitek_bench_report(test, "saitek_buf_format_switchpanel", start);
+}
+
+/*
+ * Reports alternate between two that differ in the selector, a button and
+ * (but on the Switch Panel) a detent, as when the panel is being worked
+ * hard. The input lock taken for every report is part of the cost.
+ */
+static void saitek_bench_decode_one(struct kunit *test, __u32 product_id,
+                const char *name, __u32 a, __u32 b)
+{
+        struct proflight *driver_data = saitek_test_alloc(test, product_id);
+        u64 start;
+        int i;
+
+        start = ktime_get_ns();
+        for (i = 0; i < SAITEK_BENCH_LOOPS; i++)
+                saitek_test_decode(driver_data, (i & 1) ? b : a, 3);
+        saitek_bench_report(test, name, start);
+}
+
+static void saitek_bench_decode(struct kunit *test)
+{
+        saitek_bench_decode_one(test, USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL,
+                        "saitek_proflight_radiopanel_raw_event",
+                        1 << 0 | 1 << 7 | 1 << PROFLIGHT_RP_ACTSTBY0 | 1 << 16,
+                        1 << 1 | 1 << 7);
+        saitek_bench_decode_one(test, USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL,
+                        "saitek_proflight_multipanel_raw_event",
+                        1 << 0 | 1 << PROFLIGHT_MP_AP | 1 << 5,
+                        1 << 1);
+        saitek_bench_decode_one(test, USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL,
+                        "saitek_proflight_switchpanel_raw_event",
+                        1 << 13 | 1 << PROFLIGHT_SP_MASTER_BAT,
+                        1 << 14 | 1 << PROFLIGHT_SP_GEAR_UP);
+}
+
+static struct kunit_case saitek_proflight_test_cases[] = {
+        KUNIT_CASE(saitek_test_parse_radiopanel_display),
+        KUNIT_CASE(saitek_test_format_radiopanel_display),
+        KUNIT_CASE(saitek_test_radiopanel_display_roundtrip),
+        KUNIT_CASE(saitek_test_parse_multipanel_display),
+        KUNIT_CASE(saitek_test_format_multipanel_display),
+        KUNIT_CASE(saitek_test_buf_parse_radiopanel),
+        KUNIT_CASE(saitek_test_buf_parse_multipanel),
+        KUNIT_CASE(saitek_test_buf_parse_switchpanel),
+        KUNIT_CASE(saitek_test_buf_format_radiopanel),
+        KUNIT_CASE(saitek_test_buf_format_multipanel),
+        KUNIT_CASE(saitek_test_buf_format_switchpanel),
+        KUNIT_CASE(saitek_test_radiopanel_decode),
+        KUNIT_CASE(saitek_test_multipanel_decode),
+        KUNIT_CASE(saitek_test_switchpanel_decode),
+        KUNIT_CASE(saitek_test_debounce),
+        KUNIT_CASE(saitek_test_limit),
+        KUNIT_CASE(saitek_test_driver),
+        KUNIT_CASE_SLOW(saitek_bench_display),
+        KUNIT_CASE_SLOW(saitek_bench_buf),
+        KUNIT_CASE_SLOW(saitek_bench_decode),
+        {}
+};
+
+static struct kunit_suite saitek_proflight_test_suite = {
+        .name = "saitek_proflight",
+        .exit = saitek_test_exit,
+        .test_cases = saitek_proflight_test_cases,
+};
+
+kunit_test_suite(saitek_proflight_test_suite);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("KUnit tests for the Saitek Pro Flight HID driver.");
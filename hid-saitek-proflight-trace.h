@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Tracepoints of the HID driver for Saitek Pro Flight series devices.
+ *
+ * Copyright (c) 2020 Paweł A. Ryszawa
+ */
+
+#undef TRACE_SYSTEM
+#ifdef SAITEK_PROFLIGHT_KUNIT_TEST
+#define TRACE_SYSTEM saitek_proflight_test /* the test module's own copy */
+#else
+#define TRACE_SYSTEM saitek_proflight
+#endif
+
+#if !defined(_HID_SAITEK_PROFLIGHT_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _HID_SAITEK_PROFLIGHT_TRACE_H
+
+#include <linux/hid.h>
+#include <linux/tracepoint.h>
+
+/*
+ * Input path: report arrival, then the panel specific decoding.
+ */
+
+TRACE_EVENT(saitek_raw_event,
+        TP_PROTO(struct hid_device *hdev, const u8 *data, int size),
+        TP_ARGS(hdev, data, size),
+        TP_STRUCT__entry(
+                __string(dev, dev_name(&hdev->dev))
+                __field(u32, product)
+                __field(int, size)
+                __array(u8, data, 3)
+        ),
+        TP_fast_assign(
+                __assign_str(dev);
+                __entry->product = hdev->product;
+                __entry->size = size;
+                memset(__entry->data, 0, 3);
+                memcpy(__entry->data, data, min(size, 3));
+        ),
+        TP_printk("%s product=%04x size=%d data=%02x%02x%02x",
+                __get_str(dev), __entry->product, __entry->size,
+                __entry->data[0], __entry->data[1], __entry->data[2])
+);
+
+DECLARE_EVENT_CLASS(saitek_panel_event,
+        TP_PROTO(struct hid_device *hdev, const u8 *data, int nevents),
+        TP_ARGS(hdev, data, nevents),
+        TP_STRUCT__entry(
+                __string(dev, dev_name(&hdev->dev))
+                __array(u8, data, 3)
+                __field(int, nevents)
+        ),
+        TP_fast_assign(
+                __assign_str(dev);
+                memcpy(__entry->data, data, 3);
+                __entry->nevents = nevents;
+        ),
+        TP_printk("%s data=%02x%02x%02x events=%d",
+                __get_str(dev), __entry->data[0], __entry->data[1],
+                __entry->data[2], __entry->nevents)
+);
+
+DEFINE_EVENT(saitek_panel_event, saitek_radiopanel_raw_event,
+        TP_PROTO(struct hid_device *hdev, const u8 *data, int nevents),
+        TP_ARGS(hdev, data, nevents)
+);
+
+DEFINE_EVENT(saitek_panel_event, saitek_multipanel_raw_event,
+        TP_PROTO(struct hid_device *hdev, const u8 *data, int nevents),
+        TP_ARGS(hdev, data, nevents)
+);
+
+DEFINE_EVENT(saitek_panel_event, saitek_switchpanel_raw_event,
+        TP_PROTO(struct hid_device *hdev, const u8 *data, int nevents),
+        TP_ARGS(hdev, data, nevents)
+);
+
+/*
+ * Output path: sysfs store, report building, the USB control transfer.
+ */
+
+TRACE_EVENT(saitek_store,
+        TP_PROTO(struct hid_device *hdev, const char *attr, size_t count),
+        TP_ARGS(hdev, attr, count),
+        TP_STRUCT__entry(
+                __string(dev, dev_name(&hdev->dev))
+                __string(attr, attr)
+                __field(size_t, count)
+        ),
+        TP_fast_assign(
+                __assign_str(dev);
+                __assign_str(attr);
+                __entry->count = count;
+        ),
+        TP_printk("%s attr=%s count=%zu",
+                __get_str(dev), __get_str(attr), __entry->count)
+);
+
+DECLARE_EVENT_CLASS(saitek_report,
+        TP_PROTO(struct hid_device *hdev, const u8 *report, size_t len, int res),
+        TP_ARGS(hdev, report, len, res),
+        TP_STRUCT__entry(
+                __string(dev, dev_name(&hdev->dev))
+                __field(u32, product)
+                __field(size_t, len)
+                __field(int, res)
+                __dynamic_array(u8, report, len)
+        ),
+        TP_fast_assign(
+                __assign_str(dev);
+                __entry->product = hdev->product;
+                __entry->len = len;
+                __entry->res = res;
+                memcpy(__get_dynamic_array(report), report, len);
+        ),
+        TP_printk("%s product=%04x len=%zu res=%d report=%s",
+                __get_str(dev), __entry->product, __entry->len, __entry->res,
+                __print_hex(__get_dynamic_array(report), __entry->len))
+);
+
+/* report built from the shadow by saitek_set_*() */
+DEFINE_EVENT(saitek_report, saitek_set_report,
+        TP_PROTO(struct hid_device *hdev, const u8 *report, size_t len, int res),
+        TP_ARGS(hdev, report, len, res)
+);
+
+/* report identical to the last one sent, not transferred */
+DEFINE_EVENT(saitek_report, saitek_report_skipped,
+        TP_PROTO(struct hid_device *hdev, const u8 *report, size_t len, int res),
+        TP_ARGS(hdev, report, len, res)
+);
+
+/* right before hid_hw_raw_request() */
+DEFINE_EVENT(saitek_report, saitek_hw_request,
+        TP_PROTO(struct hid_device *hdev, const u8 *report, size_t len, int res),
+        TP_ARGS(hdev, report, len, res)
+);
+
+/* hid_hw_raw_request() returned res */
+DEFINE_EVENT(saitek_report, saitek_hw_request_done,
+        TP_PROTO(struct hid_device *hdev, const u8 *report, size_t len, int res),
+        TP_ARGS(hdev, report, len, res)
+);
+
+#endif /* _HID_SAITEK_PROFLIGHT_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE hid-saitek-proflight-trace
+#include <trace/define_trace.h>
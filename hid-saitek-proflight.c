@@ -20,59 +20,106 @@
 #include <linux/ctype.h>
 #include <linux/string.h>
 #include <linux/rwsem.h>
+#include <linux/seqlock.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/atomic.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/poll.h>
+#include <linux/kfifo.h>
+#include <linux/slab.h>
+#include <linux/idr.h>
+#include <linux/kref.h>
+#include <linux/wait.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/rculist.h>
+#include <linux/log2.h>
+#include <linux/bitops.h>
+#include <linux/moduleparam.h>
+#include <linux/input.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/leds.h>
+#include <linux/led-class-multicolor.h>
+#include <linux/version.h>
+
+// const struct bin_attribute callbacks, hrtimer_setup(), disable_work_sync(),
+// single argument __assign_str(): see README.md
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 17, 0)
+#error "hid-saitek-proflight needs Linux 6.17 or later"
+#endif
+
+#include "hid-saitek-proflight.h"
+
+#define CREATE_TRACE_POINTS
+#include "hid-saitek-proflight-trace.h"
 
 
 #define SAITEK_LOCK_TYPE          struct rw_semaphore *
-#define SAITEK_LOCK_SIZE          sizeof(struct rw_semaphore)
 #define SAITEK_INIT_LOCK(lock)    init_rwsem(lock)
 #define SAITEK_LOCK_READ(lock)    down_read(lock)
 #define SAITEK_UNLOCK_READ(lock)  up_read(lock)
 #define SAITEK_LOCK_WRITE(lock)   down_write(lock)
 #define SAITEK_UNLOCK_WRITE(lock) up_write(lock)
 
+/*
+ * Input state (everything decoded from interrupt reports) is guarded by
+ * a seqlock, so that the raw event handler never sleeps and never waits
+ * for sysfs readers - readers simply retry when they race with it.
+ */
+#define SAITEK_INPUT_LOCK_TYPE                 seqlock_t
+#define SAITEK_INIT_INPUT_LOCK(lock)           seqlock_init(lock)
+#define SAITEK_INPUT_WRITE_BEGIN(lock, flags)  write_seqlock_irqsave(lock, flags)
+#define SAITEK_INPUT_WRITE_END(lock, flags)    write_sequnlock_irqrestore(lock, flags)
+#define SAITEK_INPUT_READ_BEGIN(lock)          read_seqbegin(lock)
+#define SAITEK_INPUT_READ_RETRY(lock, seq)     read_seqretry(lock, seq)
+
+/*
+ * Output state (display and LED shadow, operating mode) is guarded by an IRQ
+ * safe spinlock. It is only ever held for copying, never across USB traffic;
+ * the feature report is sent later from the output work item.
+ * Lock ordering: input lock first, then output lock.
+ */
+#define SAITEK_OUTPUT_LOCK_TYPE           spinlock_t
+#define SAITEK_INIT_OUTPUT_LOCK(lock)     spin_lock_init(lock)
+#define SAITEK_OUTPUT_LOCK(lock, flags)   spin_lock_irqsave(lock, flags)
+#define SAITEK_OUTPUT_UNLOCK(lock, flags) spin_unlock_irqrestore(lock, flags)
+
 #define SWITCH(x) ((x) ? "ON " : "OFF")
 
 #define CHECK(x) ((x) ? 1 : 0)
 
 #define MULTIPANEL_MODE(x) ( \
-                ((x) == MULTIPANEL_MODE_ALT) ? "ALT" : \
-                ((x) == MULTIPANEL_MODE_VS)  ? "VS " : \
-                ((x) == MULTIPANEL_MODE_IAS) ? "IAS" : \
-                ((x) == MULTIPANEL_MODE_HDG) ? "HDG" : \
-                ((x) == MULTIPANEL_MODE_CRS) ? "CRS" : \
+                ((x) == PROFLIGHT_MULTIPANEL_MODE_ALT) ? "ALT" : \
+                ((x) == PROFLIGHT_MULTIPANEL_MODE_VS)  ? "VS " : \
+                ((x) == PROFLIGHT_MULTIPANEL_MODE_IAS) ? "IAS" : \
+                ((x) == PROFLIGHT_MULTIPANEL_MODE_HDG) ? "HDG" : \
+                ((x) == PROFLIGHT_MULTIPANEL_MODE_CRS) ? "CRS" : \
                 "   ")
 
 #define RADIOPANEL_MODE(x) ( \
-                ((x) == RADIOPANEL_MODE_COM1) ? "COM1" : \
-                ((x) == RADIOPANEL_MODE_COM2) ? "COM2" : \
-                ((x) == RADIOPANEL_MODE_NAV1) ? "NAV1" : \
-                ((x) == RADIOPANEL_MODE_NAV2) ? "NAV2" : \
-                ((x) == RADIOPANEL_MODE_ADF) ? "ADF " : \
-                ((x) == RADIOPANEL_MODE_DME) ? "DME " : \
-                ((x) == RADIOPANEL_MODE_XPDR) ? "XPDR" : \
+                ((x) == PROFLIGHT_RADIOPANEL_MODE_COM1) ? "COM1" : \
+                ((x) == PROFLIGHT_RADIOPANEL_MODE_COM2) ? "COM2" : \
+                ((x) == PROFLIGHT_RADIOPANEL_MODE_NAV1) ? "NAV1" : \
+                ((x) == PROFLIGHT_RADIOPANEL_MODE_NAV2) ? "NAV2" : \
+                ((x) == PROFLIGHT_RADIOPANEL_MODE_ADF) ? "ADF " : \
+                ((x) == PROFLIGHT_RADIOPANEL_MODE_DME) ? "DME " : \
+                ((x) == PROFLIGHT_RADIOPANEL_MODE_XPDR) ? "XPDR" : \
                 "    ")
 
 #define SWITCHPANEL_MODE(x) ( \
-                ((x) == SWITCHPANEL_MODE_START) ? "START" : \
-                ((x) == SWITCHPANEL_MODE_BOTH)  ? "BOTH " : \
-                ((x) == SWITCHPANEL_MODE_LEFT)  ? "LEFT " : \
-                ((x) == SWITCHPANEL_MODE_RIGHT) ? "RIGHT" : \
-                ((x) == SWITCHPANEL_MODE_OFF)   ? "OFF  " : \
+                ((x) == PROFLIGHT_SWITCHPANEL_MODE_START) ? "START" : \
+                ((x) == PROFLIGHT_SWITCHPANEL_MODE_BOTH)  ? "BOTH " : \
+                ((x) == PROFLIGHT_SWITCHPANEL_MODE_LEFT)  ? "LEFT " : \
+                ((x) == PROFLIGHT_SWITCHPANEL_MODE_RIGHT) ? "RIGHT" : \
+                ((x) == PROFLIGHT_SWITCHPANEL_MODE_OFF)   ? "OFF  " : \
                 "     ")
 
-#define PANEL_DIGIT_MINUS ((char)0x0e)
-#define PANEL_DIGIT_DOT   ((char)0xd0)
-#define PANEL_DIGIT_NULL  ((char)0x0f)
-
-#define MULTIPANEL_LIGHT_AP  0x01
-#define MULTIPANEL_LIGHT_HDG 0x02
-#define MULTIPANEL_LIGHT_NAV 0x04
-#define MULTIPANEL_LIGHT_IAS 0x08
-#define MULTIPANEL_LIGHT_ALT 0x10
-#define MULTIPANEL_LIGHT_VS  0x20
-#define MULTIPANEL_LIGHT_APR 0x40
-#define MULTIPANEL_LIGHT_REV 0x80
-
 #ifndef USB_VENDOR_ID_SAITEK
 #  define USB_VENDOR_ID_SAITEK 0x06a3
 #endif
@@ -88,27 +135,15 @@
 #endif
 
 #define MAX_BUFFER PAGE_SIZE
-#define SAITEK_HID_BUF_LEN 13
-
-#define RADIOPANEL_MODE_COM1 1
-#define RADIOPANEL_MODE_COM2 2
-#define RADIOPANEL_MODE_NAV1 3
-#define RADIOPANEL_MODE_NAV2 4
-#define RADIOPANEL_MODE_ADF  5
-#define RADIOPANEL_MODE_DME  6
-#define RADIOPANEL_MODE_XPDR 7
-
-#define MULTIPANEL_MODE_ALT 1
-#define MULTIPANEL_MODE_VS  2
-#define MULTIPANEL_MODE_IAS 3
-#define MULTIPANEL_MODE_HDG 4
-#define MULTIPANEL_MODE_CRS 5
-
-#define SWITCHPANEL_MODE_START 5
-#define SWITCHPANEL_MODE_BOTH  4
-#define SWITCHPANEL_MODE_LEFT  3
-#define SWITCHPANEL_MODE_RIGHT 2
-#define SWITCHPANEL_MODE_OFF   1
+#define SAITEK_HID_BUF_LEN 23 // the longest feature report (Radio Panel)
+
+#define SAITEK_MIN_QUEUE_DEPTH 64
+#define SAITEK_MAX_QUEUE_DEPTH 65536
+#define SAITEK_MAX_REPORT_EVENTS 32 // 24 bits + 2 selectors + SYN, rounded up
+
+#define SAITEK_ACCEL_STEPS 4
+
+#define SAITEK_HIST_BUCKETS 32 // bucket n: [2^(n-1), 2^n) ns, the last one open ended
 
 #define SAITEK_MAX_BTN 9
 
@@ -119,63 +154,114 @@
 #define SAITEK_MAX_KNOB        99
 #define SAITEK_MIN_KNOB       -99
 
+/*
+ * What happens to a press or detent counter at the end of its range.
+ */
+#define SAITEK_LIMIT_CLAMP     0 // stays at min/max, the excess counted as saturation
+#define SAITEK_LIMIT_WRAP      1 // continues from the other end (e.g. heading 0-359)
+#define SAITEK_LIMIT_UNBOUNDED 2 // plain 32-bit arithmetic, min/max ignored
+
+struct saitek_limit {
+        int mode; // SAITEK_LIMIT_*
+        int min;
+        int max;
+};
+
+/*
+ * Value of the Multi Panel autopilot model (see the autopilot attribute) for
+ * one selector position, changed by step per knob detent.
+ */
+struct saitek_autopilot_value {
+        atomic_t value;
+        int step;
+        struct saitek_limit limit;
+};
+
+#define SAITEK_AUTOPILOT_VALUES (PROFLIGHT_MULTIPANEL_MODE_CRS + 1) // by PROFLIGHT_MULTIPANEL_MODE_*
+
+/*
+ * Active and standby value of the Radio Panel tuner (see the tuner attribute)
+ * for one selector position: kHz for COM, NAV, ADF and DME, the squawk code
+ * (4 octal digits) for XPDR.
+ */
+struct saitek_radio_value {
+        int active;
+        int standby;
+};
+
+#define SAITEK_RADIO_VALUES (PROFLIGHT_RADIOPANEL_MODE_XPDR + 1) // by PROFLIGHT_RADIOPANEL_MODE_*
+
+/*
+ * Animation of one 5-digit display (see the animation attribute), applied to
+ * the feature report on its way to the device; the shadow stays as written.
+ */
+#define SAITEK_ANIM_NONE    0
+#define SAITEK_ANIM_BLINK   1 // digits in mask blank every other half period
+#define SAITEK_ANIM_FLASH   2 // whole display blinks count times whenever it changes
+#define SAITEK_ANIM_MARQUEE 3 // text longer than the display scrolls by one digit per period
+
+#define SAITEK_ANIM_DISPLAYS    4 // Radio Panel: 0l, 0r, 1l, 1r; Multi Panel: 0, 1
+#define SAITEK_MARQUEE_LEN     32
+#define SAITEK_MARQUEE_GAP      2 // blanks between the end of the text and its start
+#define SAITEK_MIN_ANIM_PERIOD 20 // ms
+#define SAITEK_MAX_ANIM_PERIOD 10000 // ms
+
+struct saitek_animation {
+        int effect; // SAITEK_ANIM_*
+        unsigned int period_ms;
+        unsigned int mask; // blink: bit n - digit n (from the left)
+        unsigned int count; // flash: blinks per change
+        char text[SAITEK_MARQUEE_LEN]; // marquee: digits, as in the report
+        int len;
+        u64 start_ns; // phase reference
+        char last[5]; // flash: digits the current flash started for
+};
+
+/*
+ * Input bits of the last report, bit n (byte * 8 + bit) being the control with
+ * event code n.
+ */
+#define SAITEK_BIT(panel, code) (((panel)->bits >> (code)) & 1)
+
 struct proflight_radiopanel {
         struct proflight *parent;
-        unsigned int actstby0 : 1;
-        unsigned int actstby1 : 1;
-        unsigned int innerknob0_right : 1;
-        unsigned int innerknob0_left : 1;
-        unsigned int outerknob0_right : 1;
-        unsigned int outerknob0_left : 1;
-        unsigned int innerknob1_right : 1;
-        unsigned int innerknob1_left : 1;
-        unsigned int outerknob1_right : 1;
-        unsigned int outerknob1_left : 1;
+        __u32 bits; // last input report
         int mode0;
         int mode1;
-        int aactstby0; // accumulated
-        int aactstby1; // accumulated
-        int innerknob0; // accumulated movement (left - decreases, right - increases)
-        int outerknob0; // accumulated movement (left - decreases, right - increases)
-        int innerknob1; // accumulated movement (left - decreases, right - increases)
-        int outerknob1; // accumulated movement (left - decreases, right - increases)
+        atomic_t aactstby0; // accumulated
+        atomic_t aactstby1; // accumulated
+        atomic_t innerknob0; // accumulated movement (left - decreases, right - increases)
+        atomic_t outerknob0; // accumulated movement (left - decreases, right - increases)
+        atomic_t innerknob1; // accumulated movement (left - decreases, right - increases)
+        atomic_t outerknob1; // accumulated movement (left - decreases, right - increases)
         char display0l[5];
         char display0r[5];
         char display1l[5];
         char display1r[5];
+        int tuner; // the knobs tune the radio model, see the tuner attribute
+        int com_833; // COM channel spacing: 8.33 kHz rather than 25 kHz
+        struct saitek_radio_value radio[SAITEK_RADIO_VALUES];
 };
 
 struct proflight_multipanel {
         struct proflight *parent;
-        unsigned int hdg : 1;
-        unsigned int nav : 1;
-        unsigned int ias : 1;
-        unsigned int alt : 1;
-        unsigned int vs : 1;
-        unsigned int apr : 1;
-        unsigned int rev : 1;
-        unsigned int ap : 1;
-        unsigned int flaps_up : 1;
-        unsigned int flaps_down : 1;
-        unsigned int auto_throttle : 1;
-        unsigned int pitch_trim_up : 1;
-        unsigned int pitch_trim_down : 1;
-        unsigned int knob_right : 1;
-        unsigned int knob_left : 1;
+        __u32 bits; // last input report
         int mode;
-        int ahdg; // accumulated hdg
-        int anav; // accumulated nav
-        int aias; // accumulated ias
-        int aalt; // accumulated alt
-        int avs;  // accumualted vs
-        int aapr; // accumulated apr
-        int arev; // accumulated rev
-        int aap;  // accumulated ap
-        int flaps; // accumulated movement (DN - decreases, UP - increases)
-        int pitch_trim; // accumulated movement (DN - decreases, UP - increases)
-        int knob; // accumulated movement (left - decreases, right - increases)
+        atomic_t ahdg; // accumulated hdg
+        atomic_t anav; // accumulated nav
+        atomic_t aias; // accumulated ias
+        atomic_t aalt; // accumulated alt
+        atomic_t avs;  // accumualted vs
+        atomic_t aapr; // accumulated apr
+        atomic_t arev; // accumulated rev
+        atomic_t aap;  // accumulated ap
+        atomic_t flaps; // accumulated movement (DN - decreases, UP - increases)
+        atomic_t pitch_trim; // accumulated movement (DN - decreases, UP - increases)
+        atomic_t knob; // accumulated movement (left - decreases, right - increases)
         char display0[5];
         char display1[5];
+        int autopilot; // the knob drives the autopilot model and the displays
+        struct saitek_autopilot_value ap[SAITEK_AUTOPILOT_VALUES];
         unsigned int led_hdg : 1;
         unsigned int led_nav : 1;
         unsigned int led_ias : 1;
@@ -188,27 +274,78 @@ struct proflight_multipanel {
 
 struct proflight_switchpanel {
         struct proflight *parent;
-        unsigned int master_bat : 1;
-        unsigned int master_alt : 1;
-        unsigned int avionics : 1;
-        unsigned int fuel_pump : 1;
-        unsigned int de_ice : 1;
-        unsigned int pitot_heat : 1;
-        unsigned int cowl : 1;
-        unsigned int panel : 1;
-        unsigned int beacon : 1;
-        unsigned int nav : 1;
-        unsigned int strobe : 1;
-        unsigned int taxi : 1;
-        unsigned int landing : 1;
-        unsigned int gear_up : 1;
-        unsigned int gear_down : 1;
+        __u32 bits; // last input report
         int mode; // as per SWITCH_MODE_*
         char led_n; // 'R' = Red, 'G' = Green, 'Y' = Red+Green, '\000' = Turned off (Black)
         char led_l; // 'R' = Red, 'G' = Green, 'Y' = Red+Green, '\000' = Turned off (Black)
         char led_r; // 'R' = Red, 'G' = Green, 'Y' = Red+Green, '\000' = Turned off (Black)
 };
 
+/*
+ * Character device (/dev/proflightN) delivering input events. It is reference
+ * counted separately from the devm managed driver data, as open files may
+ * outlive the HID device.
+ */
+struct proflight_chardev {
+        struct kref kref;
+        int id; // N in /dev/proflightN
+        char name[16];
+        struct miscdevice miscdev;
+        spinlock_t lock; // clients list updates, state page, disconnected
+        struct list_head clients; // RCU
+        wait_queue_head_t wait;
+        int disconnected;
+        struct proflight_state *state; // mmap-able page, updated under lock
+};
+
+/*
+ * Every open file has its own single-producer single-consumer queue: the
+ * producer is the raw event handler (serialised by the input lock), the
+ * consumer is read() (serialised by read_mutex), so neither takes a lock
+ * the other one could wait on.
+ */
+struct proflight_client {
+        struct proflight_chardev *chardev;
+        struct list_head node;
+        struct mutex read_mutex;
+        unsigned int dropped; // events lost since last reported (producer only)
+        DECLARE_KFIFO_PTR(events, struct proflight_event);
+};
+
+/*
+ * Log2 histogram of durations in nanoseconds, updated without locking.
+ */
+struct proflight_histogram {
+        atomic64_t buckets[SAITEK_HIST_BUCKETS];
+};
+
+/*
+ * Statistics exported through debugfs (saitek_proflight/<device>/).
+ */
+struct proflight_stats {
+        atomic64_t reports; // input reports received
+        atomic64_t duplicate_reports; // identical to the previous input report
+        atomic64_t events; // events decoded (PROFLIGHT_EV_SYN not counted)
+        atomic64_t clamps; // presses or detents lost at a counter limit
+        atomic64_t glitches; // input changes suppressed by the debouncer
+        atomic64_t set_reports; // SET_REPORT requests issued
+        atomic64_t set_report_failures;
+        atomic64_t bytes_sent; // by successful SET_REPORT requests
+        struct proflight_histogram hw_request; // hid_hw_raw_request() duration
+        struct proflight_histogram store_wait; // waiting for the lock in store
+        struct proflight_histogram store_hold; // holding the lock in store
+        struct proflight_histogram show_wait; // waiting for the lock in show
+        struct proflight_histogram show_hold; // holding the lock in show
+        struct proflight_histogram raw_event_wait; // waiting for the input lock
+        struct proflight_histogram raw_event_hold; // holding the input lock
+        struct proflight_histogram parse; // saitek_buf_parse_*()
+        struct proflight_histogram format; // saitek_buf_format_*()
+        struct proflight_histogram decode; // saitek_proflight_*_raw_event()
+        u64 probe_start_ns; // CLOCK_MONOTONIC, entry to probe()
+        u64 probe_ns; // probe() itself
+        u64 ready_ns; // entry to probe() to the end of the bring-up work
+};
+
 union proflight_panel_data
 {
         struct proflight_radiopanel *radiopanel;
@@ -218,14 +355,293 @@ union proflight_panel_data
 
 struct proflight {
         int initialized;
-        SAITEK_LOCK_TYPE lock;
+        SAITEK_LOCK_TYPE lock; // sysfs and device life cycle
+        SAITEK_INPUT_LOCK_TYPE input_lock; // state decoded from input reports
+        SAITEK_OUTPUT_LOCK_TYPE output_lock; // display/LED shadow and mode
+        struct work_struct output_work; // pushes the shadow to the device
         char mode; // 'R' - reset Flaps, Pith Trim, Knob after every read; 'N' - normal
         __u32 product_id;
         union proflight_panel_data data;
         struct hid_device *hdev;
         __u8 *dmabuf;
+        struct proflight_chardev *chardev;
+        struct input_dev *input;
+        struct proflight_event events[SAITEK_MAX_REPORT_EVENTS]; // being decoded (input lock)
+        int nevents;
+        __u64 event_time_ns; // arrival time of the report being decoded
+        atomic_t events_dropped; // events lost on full queues (all open files)
+        __u8 sent[SAITEK_HID_BUF_LEN]; // last feature report the device accepted
+        size_t sent_len; // 0 - nothing sent yet (or the last transfer failed)
+        atomic_t frames_sent; // feature reports actually transferred
+        atomic_t frames_skipped; // feature reports identical to the last one sent
+        atomic_t frames_coalesced; // updates superseded before they were sent
+        __u32 raw; // last input report, before debouncing (input lock)
+        __u64 changed_ns[PROFLIGHT_MAX_CODES]; // last accepted change, by bit (input lock)
+        struct delayed_work debounce_work; // re-evaluates changes held back by the debouncer
+        struct work_struct bringup_work; // second half of probe, see saitek_proflight_bringup_work()
+        __u64 detent_ns[PROFLIGHT_MAX_CODES]; // last detent, by encoder code (input lock)
+        int detent_dir[PROFLIGHT_MAX_CODES]; // its direction, +1 or -1
+        struct saitek_limit limits[PROFLIGHT_MAX_CODES]; // of the counters, by code (input lock)
+        atomic_t saturated[PROFLIGHT_MAX_CODES]; // presses or detents lost at a limit, by code
+        struct proflight_stats stats;
+        struct dentry *debugfs;
+        __u8 pages[PROFLIGHT_PAGES][PROFLIGHT_FRAME_LEN]; // by selector position (output lock)
+        unsigned long pages_valid; // bit n - pages[n] has been written (output lock)
+        struct saitek_animation anim[SAITEK_ANIM_DISPLAYS]; // by display (output lock)
+        struct hrtimer anim_timer; // next change of an animated display
+        struct saitek_led *leds; // LED class devices (none on the Radio Panel)
+        int nleds;
+        struct proflight_rule rules[PROFLIGHT_MAX_RULES]; // see the rules attribute (input lock)
+        int nrules;
+};
+
+/*
+ * Input decoding. Only the bits that differ from the previous report are
+ * looked at, each through the per-product table below that tells which
+ * control the bit belongs to.
+ */
+#define SAITEK_CTL_NONE        0 // unused bit
+#define SAITEK_CTL_KEY         1 // switch, reported as is
+#define SAITEK_CTL_COUNTED_KEY 2 // button, presses accumulated in a counter
+#define SAITEK_CTL_ENC_UP      3 // right/up bit of an encoder, detents accumulated in a counter
+#define SAITEK_CTL_ENC_DOWN    4 // left/down bit of an encoder, detents accumulated in a counter
+#define SAITEK_CTL_SEL         5 // position of a rotary selector
+
+struct saitek_control {
+        int kind; // SAITEK_CTL_*
+        __u16 code; // event code; selector: PROFLIGHT_SEL_*
+        int value; // default max (down: min) of the counter; selector: *_MODE_*
+        size_t counter; // offset of the atomic_t counter in the panel data
+};
+
+struct saitek_selector {
+        __u32 mask; // bits of all its positions
+        int msb_first; // the highest position wins when several bits are set
+        size_t mode; // offset of the int holding the position in the panel data
+};
+
+struct saitek_decoder {
+        struct saitek_control controls[PROFLIGHT_MAX_CODES]; // by bit
+        struct saitek_selector selectors[2]; // by PROFLIGHT_SEL_*
+        int nselectors;
+};
+
+#define SAITEK_KEY(code) \
+        [code] = { SAITEK_CTL_KEY, code }
+#define SAITEK_COUNTED_KEY(panel, code, counter) \
+        [code] = { SAITEK_CTL_COUNTED_KEY, code, SAITEK_MAX_BTN, \
+                offsetof(struct proflight_ ## panel, counter) }
+#define SAITEK_ENCODER(panel, code, up, down, counter, max, min) \
+        [up] = { SAITEK_CTL_ENC_UP, code, max, offsetof(struct proflight_ ## panel, counter) }, \
+        [down] = { SAITEK_CTL_ENC_DOWN, code, min, offsetof(struct proflight_ ## panel, counter) }
+#define SAITEK_SEL(bit, sel, mode) \
+        [bit] = { SAITEK_CTL_SEL, sel, mode }
+
+static const struct saitek_decoder saitek_radiopanel_decoder = {
+        .controls = {
+                SAITEK_SEL(0, PROFLIGHT_SEL_0, PROFLIGHT_RADIOPANEL_MODE_COM1),
+                SAITEK_SEL(1, PROFLIGHT_SEL_0, PROFLIGHT_RADIOPANEL_MODE_COM2),
+                SAITEK_SEL(2, PROFLIGHT_SEL_0, PROFLIGHT_RADIOPANEL_MODE_NAV1),
+                SAITEK_SEL(3, PROFLIGHT_SEL_0, PROFLIGHT_RADIOPANEL_MODE_NAV2),
+                SAITEK_SEL(4, PROFLIGHT_SEL_0, PROFLIGHT_RADIOPANEL_MODE_ADF),
+                SAITEK_SEL(5, PROFLIGHT_SEL_0, PROFLIGHT_RADIOPANEL_MODE_DME),
+                SAITEK_SEL(6, PROFLIGHT_SEL_0, PROFLIGHT_RADIOPANEL_MODE_XPDR),
+                SAITEK_SEL(7, PROFLIGHT_SEL_1, PROFLIGHT_RADIOPANEL_MODE_COM1),
+                SAITEK_SEL(8, PROFLIGHT_SEL_1, PROFLIGHT_RADIOPANEL_MODE_COM2),
+                SAITEK_SEL(9, PROFLIGHT_SEL_1, PROFLIGHT_RADIOPANEL_MODE_NAV1),
+                SAITEK_SEL(10, PROFLIGHT_SEL_1, PROFLIGHT_RADIOPANEL_MODE_NAV2),
+                SAITEK_SEL(11, PROFLIGHT_SEL_1, PROFLIGHT_RADIOPANEL_MODE_ADF),
+                SAITEK_SEL(12, PROFLIGHT_SEL_1, PROFLIGHT_RADIOPANEL_MODE_DME),
+                SAITEK_SEL(13, PROFLIGHT_SEL_1, PROFLIGHT_RADIOPANEL_MODE_XPDR),
+                SAITEK_COUNTED_KEY(radiopanel, PROFLIGHT_RP_ACTSTBY0, aactstby0),
+                SAITEK_COUNTED_KEY(radiopanel, PROFLIGHT_RP_ACTSTBY1, aactstby1),
+                SAITEK_ENCODER(radiopanel, PROFLIGHT_RP_INNERKNOB0, 16, 17, innerknob0, SAITEK_MAX_KNOB, SAITEK_MIN_KNOB),
+                SAITEK_ENCODER(radiopanel, PROFLIGHT_RP_OUTERKNOB0, 18, 19, outerknob0, SAITEK_MAX_KNOB, SAITEK_MIN_KNOB),
+                SAITEK_ENCODER(radiopanel, PROFLIGHT_RP_INNERKNOB1, 20, 21, innerknob1, SAITEK_MAX_KNOB, SAITEK_MIN_KNOB),
+                SAITEK_ENCODER(radiopanel, PROFLIGHT_RP_OUTERKNOB1, 22, 23, outerknob1, SAITEK_MAX_KNOB, SAITEK_MIN_KNOB),
+        },
+        .selectors = {
+                { 0x00007f, 0, offsetof(struct proflight_radiopanel, mode0) },
+                { 0x003f80, 0, offsetof(struct proflight_radiopanel, mode1) },
+        },
+        .nselectors = 2,
+};
+
+static const struct saitek_decoder saitek_multipanel_decoder = {
+        .controls = {
+                SAITEK_SEL(0, PROFLIGHT_SEL_0, PROFLIGHT_MULTIPANEL_MODE_ALT),
+                SAITEK_SEL(1, PROFLIGHT_SEL_0, PROFLIGHT_MULTIPANEL_MODE_VS),
+                SAITEK_SEL(2, PROFLIGHT_SEL_0, PROFLIGHT_MULTIPANEL_MODE_IAS),
+                SAITEK_SEL(3, PROFLIGHT_SEL_0, PROFLIGHT_MULTIPANEL_MODE_HDG),
+                SAITEK_SEL(4, PROFLIGHT_SEL_0, PROFLIGHT_MULTIPANEL_MODE_CRS),
+                SAITEK_ENCODER(multipanel, PROFLIGHT_MP_KNOB, 5, 6, knob, SAITEK_MAX_KNOB, SAITEK_MIN_KNOB),
+                SAITEK_COUNTED_KEY(multipanel, PROFLIGHT_MP_AP, aap),
+                SAITEK_COUNTED_KEY(multipanel, PROFLIGHT_MP_HDG, ahdg),
+                SAITEK_COUNTED_KEY(multipanel, PROFLIGHT_MP_NAV, anav),
+                SAITEK_COUNTED_KEY(multipanel, PROFLIGHT_MP_IAS, aias),
+                SAITEK_COUNTED_KEY(multipanel, PROFLIGHT_MP_ALT, aalt),
+                SAITEK_COUNTED_KEY(multipanel, PROFLIGHT_MP_VS, avs),
+                SAITEK_COUNTED_KEY(multipanel, PROFLIGHT_MP_APR, aapr),
+                SAITEK_COUNTED_KEY(multipanel, PROFLIGHT_MP_REV, arev),
+                SAITEK_KEY(PROFLIGHT_MP_AUTO_THROTTLE),
+                SAITEK_ENCODER(multipanel, PROFLIGHT_MP_FLAPS, 16, 17, flaps, SAITEK_MAX_FLAPS, SAITEK_MIN_FLAPS),
+                SAITEK_ENCODER(multipanel, PROFLIGHT_MP_PITCH_TRIM, 19, 18, pitch_trim, SAITEK_MAX_PITCH_TRIM, SAITEK_MIN_PITCH_TRIM),
+        },
+        .selectors = {
+                { 0x00001f, 0, offsetof(struct proflight_multipanel, mode) },
+        },
+        .nselectors = 1,
+};
+
+static const struct saitek_decoder saitek_switchpanel_decoder = {
+        .controls = {
+                SAITEK_KEY(PROFLIGHT_SP_MASTER_BAT),
+                SAITEK_KEY(PROFLIGHT_SP_MASTER_ALT),
+                SAITEK_KEY(PROFLIGHT_SP_AVIONICS),
+                SAITEK_KEY(PROFLIGHT_SP_FUEL_PUMP),
+                SAITEK_KEY(PROFLIGHT_SP_DE_ICE),
+                SAITEK_KEY(PROFLIGHT_SP_PITOT_HEAT),
+                SAITEK_KEY(PROFLIGHT_SP_COWL),
+                SAITEK_KEY(PROFLIGHT_SP_PANEL),
+                SAITEK_KEY(PROFLIGHT_SP_BEACON),
+                SAITEK_KEY(PROFLIGHT_SP_NAV),
+                SAITEK_KEY(PROFLIGHT_SP_STROBE),
+                SAITEK_KEY(PROFLIGHT_SP_TAXI),
+                SAITEK_KEY(PROFLIGHT_SP_LANDING),
+                SAITEK_SEL(13, PROFLIGHT_SEL_0, PROFLIGHT_SWITCHPANEL_MODE_OFF),
+                SAITEK_SEL(14, PROFLIGHT_SEL_0, PROFLIGHT_SWITCHPANEL_MODE_RIGHT),
+                SAITEK_SEL(15, PROFLIGHT_SEL_0, PROFLIGHT_SWITCHPANEL_MODE_LEFT),
+                SAITEK_SEL(16, PROFLIGHT_SEL_0, PROFLIGHT_SWITCHPANEL_MODE_BOTH),
+                SAITEK_SEL(17, PROFLIGHT_SEL_0, PROFLIGHT_SWITCHPANEL_MODE_START),
+                SAITEK_KEY(PROFLIGHT_SP_GEAR_UP),
+                SAITEK_KEY(PROFLIGHT_SP_GEAR_DOWN),
+        },
+        .selectors = {
+                { 0x03e000, 1, offsetof(struct proflight_switchpanel, mode) }, // START wins
+        },
+        .nselectors = 1,
 };
 
+#undef SAITEK_SEL
+#undef SAITEK_ENCODER
+#undef SAITEK_COUNTED_KEY
+#undef SAITEK_KEY
+
+static const struct saitek_decoder *saitek_proflight_decoder(__u32 product_id)
+{
+        switch (product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                return &saitek_radiopanel_decoder;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                return &saitek_multipanel_decoder;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                return &saitek_switchpanel_decoder;
+        }
+
+        return NULL;
+}
+
+/*
+ * Panel data the decoder table offsets point into.
+ */
+static void *saitek_proflight_panel(struct proflight *driver_data)
+{
+        switch (driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                return driver_data->data.radiopanel;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                return driver_data->data.multipanel;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                return driver_data->data.switchpanel;
+        }
+
+        return NULL;
+}
+
+/*
+ * Counters start clamped at the limits in the decoder tables: presses at
+ * 0..SAITEK_MAX_BTN, detents at SAITEK_MIN_*..SAITEK_MAX_*.
+ */
+static void saitek_proflight_init_limits(struct proflight *driver_data)
+{
+        const struct saitek_decoder *decoder;
+        const struct saitek_control *ctl;
+        int bit;
+
+        decoder = saitek_proflight_decoder(driver_data->product_id);
+        if (!decoder)
+                return;
+        for (bit = 0; bit < PROFLIGHT_MAX_CODES; bit++) {
+                ctl = &decoder->controls[bit];
+                switch (ctl->kind) {
+                case SAITEK_CTL_COUNTED_KEY:
+                case SAITEK_CTL_ENC_UP:
+                        driver_data->limits[ctl->code].max = ctl->value;
+                        break;
+                case SAITEK_CTL_ENC_DOWN:
+                        driver_data->limits[ctl->code].min = ctl->value;
+                        break;
+                }
+        }
+}
+
+/*
+ * Whether code names a control with a counter (a counted button or an
+ * encoder, which is named after its right/up bit).
+ */
+static int saitek_proflight_has_counter(const struct saitek_decoder *decoder, unsigned int code)
+{
+        if (code >= PROFLIGHT_MAX_CODES)
+                return 0;
+
+        return decoder->controls[code].kind == SAITEK_CTL_COUNTED_KEY
+                        || decoder->controls[code].kind == SAITEK_CTL_ENC_UP;
+}
+
+/*
+ * Brings value into a clamp or wrap limit. The range may take up to 2^32
+ * values, so the wrap divides with div64_s64(), a plain % on s64 needs
+ * libgcc on 32-bit.
+ */
+static int saitek_limit_apply(const struct saitek_limit *limit, s64 value)
+{
+        s64 range, pos;
+
+        if (limit->mode != SAITEK_LIMIT_WRAP)
+                return clamp_t(s64, value, limit->min, limit->max);
+
+        range = (s64)limit->max - limit->min + 1;
+        pos = value - limit->min;
+        pos -= div64_s64(pos, range) * range;
+        return limit->min + (pos < 0 ? pos + range : pos);
+}
+
+/*
+ * Adds delta to the counter within its limits. Returns false when a clamp
+ * cut anything off.
+ */
+static bool saitek_counter_add(atomic_t *counter, int delta, const struct saitek_limit *limit)
+{
+        int old, new;
+
+        if (limit->mode == SAITEK_LIMIT_UNBOUNDED) {
+                atomic_add(delta, counter);
+                return true;
+        }
+
+        old = atomic_read(counter);
+        do {
+                new = saitek_limit_apply(limit, (s64)old + delta);
+        } while (new != old && !atomic_try_cmpxchg(counter, &old, new));
+
+        return limit->mode == SAITEK_LIMIT_WRAP || (s64)new == (s64)old + delta;
+}
+
+static void saitek_hist_add(struct proflight_histogram *hist, u64 ns)
+{
+        atomic64_inc(&hist->buckets[min_t(int, fls64(ns), SAITEK_HIST_BUCKETS - 1)]);
+}
+
 static void saitek_parse_radiopanel_display(char *display, const char *buf, size_t bufsize)
 {
         int digno = 0;
@@ -235,20 +651,20 @@ static void saitek_parse_radiopanel_display(char *display, const char *buf, size
         while (digno < 5) {
                 ch = (i < bufsize) ? buf[i++] : ' ';
                 if (ch == ' ') {
-                        display[digno++] = PANEL_DIGIT_NULL;
+                        display[digno++] = PROFLIGHT_PANEL_DIGIT_NULL;
                 } else if (isdigit(ch)) {
                         display[digno++] = ch - '0';
                 } else if (ch == '.') {
                         if (digno == 0)
-                                display[digno++] = PANEL_DIGIT_NULL;
-                        display[digno - 1] |= PANEL_DIGIT_DOT;
+                                display[digno++] = PROFLIGHT_PANEL_DIGIT_NULL;
+                        display[digno - 1] |= PROFLIGHT_PANEL_DIGIT_DOT;
                 } else {
-                        display[digno++] = PANEL_DIGIT_NULL;
+                        display[digno++] = PROFLIGHT_PANEL_DIGIT_NULL;
                 }
         }
         if (i < bufsize && digno > 0)
                 if (buf[i] == '.')
-                        display[digno - 1] |= PANEL_DIGIT_DOT;
+                        display[digno - 1] |= PROFLIGHT_PANEL_DIGIT_DOT;
 }
 
 static void saitek_parse_multipanel_display(char *display, const char *buf, size_t bufsize)
@@ -260,13 +676,13 @@ static void saitek_parse_multipanel_display(char *display, const char *buf, size
         while (digno < 5 && i < bufsize) {
                 ch = buf[i++];
                 if (ch == ' ')
-                        display[digno++] = PANEL_DIGIT_NULL;
+                        display[digno++] = PROFLIGHT_PANEL_DIGIT_NULL;
                 else if (ch == '-')
-                        display[digno++] = PANEL_DIGIT_MINUS;
+                        display[digno++] = PROFLIGHT_PANEL_DIGIT_MINUS;
                 else if (isdigit(ch))
                         display[digno++] = ch - '0';
                 else
-                        display[digno++] = PANEL_DIGIT_NULL;
+                        display[digno++] = PROFLIGHT_PANEL_DIGIT_NULL;
         }
 }
 
@@ -280,13 +696,13 @@ static int saitek_format_radiopanel_display(char *buf, const char *display, size
                 dig = display[i] & (char)0x0f;
                 digflag = display[i] & (char)0xf0;
                 i++;
-                if (dig == PANEL_DIGIT_NULL)
+                if (dig == PROFLIGHT_PANEL_DIGIT_NULL)
                         buf[chno++] = ' ';
                 else if (0 <= dig && dig < 10)
                         buf[chno++] = '0' + dig;
                 else
                         buf[chno++] = '?';
-                if (digflag == PANEL_DIGIT_DOT)
+                if (digflag == (char)PROFLIGHT_PANEL_DIGIT_DOT)
                         buf[chno++] = '.';
         }
 
@@ -301,9 +717,9 @@ static void saitek_format_multipanel_display(char *buf, const char *display, siz
 
         while (chno < bufsize && i < 5) {
                 dig = display[i++];
-                if (dig == PANEL_DIGIT_NULL)
+                if (dig == PROFLIGHT_PANEL_DIGIT_NULL)
                         buf[chno++] = ' ';
-                else if (dig == PANEL_DIGIT_MINUS)
+                else if (dig == PROFLIGHT_PANEL_DIGIT_MINUS)
                         buf[chno++] = '-';
                 else if (0 <= dig && dig < 10)
                         buf[chno++] = '0' + dig;
@@ -312,6 +728,14 @@ static void saitek_format_multipanel_display(char *buf, const char *display, siz
         }
 }
 
+/*
+ * Text of the proflight attribute. Its columns only stay fixed while the
+ * counters are within the default limits (presses 0..9, detents -99..99): a
+ * counter given a wider range by the limits attribute takes as many characters
+ * as it needs and shifts the fields after it, which stay one space apart.
+ * Counters with such ranges are better read from the deltas attribute or from
+ * /dev/proflightN.
+ */
 static int saitek_buf_format_radiopanel(char *buf, struct proflight_radiopanel *radiopanel)
 {
         int len;
@@ -333,23 +757,13 @@ static int saitek_buf_format_radiopanel(char *buf, struct proflight_radiopanel *
                         "%c %1.1d %3.2d %3.2d %4.4s "
                         "%c %1.1d %3.2d %3.2d %4.4s",
                         hrdisp0l, hrdisp0r, hrdisp1l, hrdisp1r, radiopanel->parent->mode,
-                        radiopanel->actstby0 ? '1' : '0', radiopanel->aactstby0,
-                        radiopanel->innerknob0, radiopanel->outerknob0,
+                        SAITEK_BIT(radiopanel, PROFLIGHT_RP_ACTSTBY0) ? '1' : '0', atomic_read(&radiopanel->aactstby0),
+                        atomic_read(&radiopanel->innerknob0), atomic_read(&radiopanel->outerknob0),
                         RADIOPANEL_MODE(radiopanel->mode0),
-                        radiopanel->actstby1 ? '1' : '0', radiopanel->aactstby1,
-                        radiopanel->innerknob1, radiopanel->outerknob1,
+                        SAITEK_BIT(radiopanel, PROFLIGHT_RP_ACTSTBY1) ? '1' : '0', atomic_read(&radiopanel->aactstby1),
+                        atomic_read(&radiopanel->innerknob1), atomic_read(&radiopanel->outerknob1),
                         RADIOPANEL_MODE(radiopanel->mode1)
         );
-        switch (radiopanel->parent->mode) {
-                case 'R':
-                        radiopanel->aactstby0 = 0;
-                        radiopanel->aactstby1 = 0;
-                        radiopanel->innerknob0 = 0;
-                        radiopanel->outerknob0 = 0;
-                        radiopanel->innerknob1 = 0;
-                        radiopanel->outerknob1 = 0;
-                        break;
-        }
 
         return len;
 }
@@ -375,14 +789,14 @@ static int saitek_buf_format_multipanel(char *buf, struct proflight_multipanel *
         leds[6] = multipanel->led_rev ? '1' : '0';
         leds[7] = multipanel->led_ap  ? '1' : '0';
         leds[8] = 0;
-        btns[0] = multipanel->hdg ? '1' : '0';
-        btns[1] = multipanel->nav ? '1' : '0';
-        btns[2] = multipanel->ias ? '1' : '0';
-        btns[3] = multipanel->alt ? '1' : '0';
-        btns[4] = multipanel->vs  ? '1' : '0';
-        btns[5] = multipanel->apr ? '1' : '0';
-        btns[6] = multipanel->rev ? '1' : '0';
-        btns[7] = multipanel->ap  ? '1' : '0';
+        btns[0] = SAITEK_BIT(multipanel, PROFLIGHT_MP_HDG) ? '1' : '0';
+        btns[1] = SAITEK_BIT(multipanel, PROFLIGHT_MP_NAV) ? '1' : '0';
+        btns[2] = SAITEK_BIT(multipanel, PROFLIGHT_MP_IAS) ? '1' : '0';
+        btns[3] = SAITEK_BIT(multipanel, PROFLIGHT_MP_ALT) ? '1' : '0';
+        btns[4] = SAITEK_BIT(multipanel, PROFLIGHT_MP_VS)  ? '1' : '0';
+        btns[5] = SAITEK_BIT(multipanel, PROFLIGHT_MP_APR) ? '1' : '0';
+        btns[6] = SAITEK_BIT(multipanel, PROFLIGHT_MP_REV) ? '1' : '0';
+        btns[7] = SAITEK_BIT(multipanel, PROFLIGHT_MP_AP)  ? '1' : '0';
         btns[8] = 0;
         len = snprintf(buf, MAX_BUFFER,
                         "[MP] %5.5s %5.5s %8.8s %c %8.8s %c %+3.2d %+3.2d %+3.2d "
@@ -393,39 +807,27 @@ static int saitek_buf_format_multipanel(char *buf, struct proflight_multipanel *
                         "\nAPR:%s (%1.1d)\nREV:%s (%1.1d)\nAP:%s (%1.1d)\n"
                         "AUTO-THROTTLE:%s\nFLAPS:%3d\nPITCH-TRIM:%3d\nKNOB:%3d",
                         hrdisp0, hrdisp1, leds, multipanel->parent->mode, btns,
-                        multipanel->auto_throttle ? '1' : '0',
-                        multipanel->flaps, multipanel->pitch_trim, multipanel->knob,
-                        multipanel->ahdg, multipanel->anav, multipanel->aias,
-                        multipanel->aalt, multipanel->avs, multipanel->aapr,
-                        multipanel->arev, multipanel->aap,
+                        SAITEK_BIT(multipanel, PROFLIGHT_MP_AUTO_THROTTLE) ? '1' : '0',
+                        atomic_read(&multipanel->flaps), atomic_read(&multipanel->pitch_trim),
+                        atomic_read(&multipanel->knob),
+                        atomic_read(&multipanel->ahdg), atomic_read(&multipanel->anav),
+                        atomic_read(&multipanel->aias), atomic_read(&multipanel->aalt),
+                        atomic_read(&multipanel->avs), atomic_read(&multipanel->aapr),
+                        atomic_read(&multipanel->arev), atomic_read(&multipanel->aap),
                         MULTIPANEL_MODE(multipanel->mode),
                         MULTIPANEL_MODE(multipanel->mode),
-                        SWITCH(multipanel->hdg), multipanel->ahdg,
-                        SWITCH(multipanel->nav), multipanel->anav,
-                        SWITCH(multipanel->ias), multipanel->aias,
-                        SWITCH(multipanel->alt), multipanel->aalt,
-                        SWITCH(multipanel->vs), multipanel->avs,
-                        SWITCH(multipanel->apr), multipanel->aapr,
-                        SWITCH(multipanel->rev), multipanel->arev,
-                        SWITCH(multipanel->ap), multipanel->aap,
-                        SWITCH(multipanel->auto_throttle),
-                        multipanel->flaps, multipanel->pitch_trim, multipanel->knob);
-        switch (multipanel->parent->mode) {
-                case 'R':
-                        multipanel->flaps = 0;
-                        multipanel->pitch_trim = 0;
-                        multipanel->knob = 0;
-                        multipanel->ahdg = 0;
-                        multipanel->anav = 0;
-                        multipanel->aias = 0;
-                        multipanel->aalt = 0;
-                        multipanel->avs  = 0;
-                        multipanel->aapr = 0;
-                        multipanel->arev = 0;
-                        multipanel->aap  = 0;
-                        break;
-        }
-        
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_HDG)), atomic_read(&multipanel->ahdg),
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_NAV)), atomic_read(&multipanel->anav),
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_IAS)), atomic_read(&multipanel->aias),
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_ALT)), atomic_read(&multipanel->aalt),
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_VS)), atomic_read(&multipanel->avs),
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_APR)), atomic_read(&multipanel->aapr),
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_REV)), atomic_read(&multipanel->arev),
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_AP)), atomic_read(&multipanel->aap),
+                        SWITCH(SAITEK_BIT(multipanel, PROFLIGHT_MP_AUTO_THROTTLE)),
+                        atomic_read(&multipanel->flaps), atomic_read(&multipanel->pitch_trim),
+                        atomic_read(&multipanel->knob));
+
         return len;
 }
 
@@ -439,46 +841,177 @@ static int saitek_buf_format_switchpanel(char *buf, struct proflight_switchpanel
                         switchpanel->led_l ? switchpanel->led_l : '-',
                         switchpanel->led_r ? switchpanel->led_r : '-',
                         SWITCHPANEL_MODE(switchpanel->mode),
-                        switchpanel->master_bat ? '1' : '0',
-                        switchpanel->master_alt ? '1' : '0',
-                        switchpanel->avionics   ? '1' : '0',
-                        switchpanel->fuel_pump  ? '1' : '0',
-                        switchpanel->de_ice     ? '1' : '0',
-                        switchpanel->pitot_heat ? '1' : '0',
-                        switchpanel->cowl       ? '1' : '0',
-                        switchpanel->panel      ? '1' : '0',
-                        switchpanel->beacon     ? '1' : '0',
-                        switchpanel->nav        ? '1' : '0',
-                        switchpanel->strobe     ? '1' : '0',
-                        switchpanel->taxi       ? '1' : '0',
-                        switchpanel->landing    ? '1' : '0',
-                        switchpanel->gear_up ? 'U' : switchpanel->gear_down ? 'D' : ' ');
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_MASTER_BAT) ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_MASTER_ALT) ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_AVIONICS)   ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_FUEL_PUMP)  ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_DE_ICE)     ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_PITOT_HEAT) ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_COWL)       ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_PANEL)      ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_BEACON)     ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_NAV)        ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_STROBE)     ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_TAXI)       ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_LANDING)    ? '1' : '0',
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_GEAR_UP) ? 'U' :
+                        SAITEK_BIT(switchpanel, PROFLIGHT_SP_GEAR_DOWN) ? 'D' : ' ');
         
         return len;
 }
 
+/*
+ * Sends the feature report prepared in dmabuf, unless it is identical to the
+ * last one the device accepted. Called from the output work item only.
+ */
+static int saitek_proflight_send_report(struct proflight *driver_data, size_t len)
+{
+        u64 start;
+        int res;
+
+        if (driver_data->sent_len == len
+                        && !memcmp(driver_data->sent, driver_data->dmabuf, len)) {
+                atomic_inc(&driver_data->frames_skipped);
+                trace_saitek_report_skipped(driver_data->hdev, driver_data->dmabuf, len, 0);
+                return 0;
+        }
+
+        trace_saitek_hw_request(driver_data->hdev, driver_data->dmabuf, len, 0);
+        atomic64_inc(&driver_data->stats.set_reports);
+        start = ktime_get_ns();
+        res = hid_hw_raw_request(driver_data->hdev,
+                        driver_data->dmabuf[0], driver_data->dmabuf,
+                        len, HID_FEATURE_REPORT, HID_REQ_SET_REPORT);
+        saitek_hist_add(&driver_data->stats.hw_request, ktime_get_ns() - start);
+        trace_saitek_hw_request_done(driver_data->hdev, driver_data->dmabuf, len, res);
+        if (res < 0) {
+                atomic64_inc(&driver_data->stats.set_report_failures);
+                driver_data->sent_len = 0; // device state unknown, resend next time
+                return res;
+        }
+        atomic64_add(res, &driver_data->stats.bytes_sent);
+        memcpy(driver_data->sent, driver_data->dmabuf, len);
+        driver_data->sent_len = len;
+        atomic_inc(&driver_data->frames_sent);
+
+        return res;
+}
+
+/*
+ * Applies an animation to the 5 digits of its display in the report. Returns
+ * when they are due to change next, U64_MAX if never.
+ */
+static u64 saitek_animate_display(struct saitek_animation *anim, __u8 *digits, u64 now)
+{
+        u64 half = (u64)anim->period_ms * NSEC_PER_MSEC / 2;
+        u64 n, next;
+        int pos, i, j;
+
+        switch (anim->effect) {
+        case SAITEK_ANIM_BLINK:
+                n = div64_u64(now - anim->start_ns, half);
+                if (n & 1)
+                        for (i = 0; i < 5; i++)
+                                if (anim->mask & (1u << i))
+                                        digits[i] = PROFLIGHT_PANEL_DIGIT_NULL;
+                return anim->start_ns + (n + 1) * half;
+        case SAITEK_ANIM_FLASH:
+                if (memcmp(digits, anim->last, 5)) {
+                        memcpy(anim->last, digits, 5);
+                        anim->start_ns = now;
+                }
+                n = div64_u64(now - anim->start_ns, half);
+                if (n >= 2 * anim->count)
+                        return U64_MAX;
+                if (n & 1)
+                        memset(digits, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+                return anim->start_ns + (n + 1) * half;
+        case SAITEK_ANIM_MARQUEE:
+                if (anim->len <= 5) { // fits, nothing to scroll
+                        for (i = 0; i < 5; i++)
+                                digits[i] = (i < anim->len) ? anim->text[i] : PROFLIGHT_PANEL_DIGIT_NULL;
+                        return U64_MAX;
+                }
+                n = div64_u64(now - anim->start_ns, 2 * half);
+                next = anim->start_ns + (n + 1) * 2 * half;
+                pos = do_div(n, anim->len + SAITEK_MARQUEE_GAP);
+                for (i = 0; i < 5; i++) {
+                        j = (pos + i) % (anim->len + SAITEK_MARQUEE_GAP);
+                        digits[i] = (j < anim->len) ? anim->text[j] : PROFLIGHT_PANEL_DIGIT_NULL;
+                }
+                return next;
+        }
+
+        return U64_MAX;
+}
+
+/*
+ * Animates the displays of a report just built from the shadow, and arms the
+ * animation timer for their next change; the timer callback then schedules
+ * the output work, which comes back here. Called with the output lock held.
+ */
+static void saitek_proflight_animate(struct proflight *driver_data, __u8 *report,
+                int ndisplays)
+{
+        u64 now = ktime_get_ns();
+        u64 next = U64_MAX;
+        int i;
+
+        for (i = 0; i < ndisplays; i++)
+                next = min(next, saitek_animate_display(&driver_data->anim[i],
+                                        &report[1 + 5 * i], now));
+        if (next != U64_MAX)
+                hrtimer_start(&driver_data->anim_timer, ns_to_ktime(next), HRTIMER_MODE_ABS);
+}
+
+static enum hrtimer_restart saitek_proflight_anim_timer(struct hrtimer *timer)
+{
+        struct proflight *driver_data = container_of(timer, struct proflight, anim_timer);
+
+        queue_work(system_highpri_wq, &driver_data->output_work);
+
+        return HRTIMER_NORESTART;
+}
+
+/*
+ * Builds the feature report from the shadow state. Called with the output lock
+ * held; returns the report length.
+ */
+static size_t saitek_fill_radiopanel_report(struct proflight_radiopanel *radiopanel, __u8 *report)
+{
+        report[0] = 0; // also: report id
+        memcpy(&(report[1]), radiopanel->display0l, 5);
+        memcpy(&(report[6]), radiopanel->display0r, 5);
+        memcpy(&(report[11]), radiopanel->display1l, 5);
+        memcpy(&(report[16]), radiopanel->display1r, 5);
+        report[21] = 0;
+        report[22] = 0;
+
+        return 23;
+}
+
 static int saitek_set_radiopanel(struct proflight_radiopanel *radiopanel)
 {
+        unsigned long flags;
+        size_t len;
         int res = 0;
 
-        radiopanel->parent->dmabuf[0] = 0; // also: report id
-        memcpy(&(radiopanel->parent->dmabuf[1]), radiopanel->display0l, 5);
-        memcpy(&(radiopanel->parent->dmabuf[6]), radiopanel->display0r, 5);
-        memcpy(&(radiopanel->parent->dmabuf[11]), radiopanel->display1l, 5);
-        memcpy(&(radiopanel->parent->dmabuf[16]), radiopanel->display1r, 5);
-        radiopanel->parent->dmabuf[21] = 0;
-        radiopanel->parent->dmabuf[22] = 0;
-
-        res = hid_hw_raw_request(radiopanel->parent->hdev,
-                        radiopanel->parent->dmabuf[0], radiopanel->parent->dmabuf,
-                        23, HID_FEATURE_REPORT, HID_REQ_SET_REPORT);
-        
+        SAITEK_OUTPUT_LOCK(&radiopanel->parent->output_lock, flags);
+        len = saitek_fill_radiopanel_report(radiopanel, radiopanel->parent->dmabuf);
+        saitek_proflight_animate(radiopanel->parent, radiopanel->parent->dmabuf, 4);
+        SAITEK_OUTPUT_UNLOCK(&radiopanel->parent->output_lock, flags);
+        trace_saitek_set_report(radiopanel->parent->hdev, radiopanel->parent->dmabuf, len, 0);
+
+        res = saitek_proflight_send_report(radiopanel->parent, len);
+
         return res;
 }
 
 static void saitek_buf_parse_radiopanel(struct proflight_radiopanel *radiopanel,
                 const char *buf, size_t count)
 {
+        unsigned long flags;
+
         if (count < 45) {
                 hid_err(radiopanel->parent->hdev,
                                 "Saitek ProFlight Radio Panel state ('%.*s') too short (%li).\n",
@@ -489,6 +1022,7 @@ static void saitek_buf_parse_radiopanel(struct proflight_radiopanel *radiopanel,
                                 "Saitek ProFlight Radio Panel state ('%.*s') too long (%li).\n",
                                 (int)count, buf, count);
         }
+        SAITEK_OUTPUT_LOCK(&radiopanel->parent->output_lock, flags);
         saitek_parse_radiopanel_display(radiopanel->display0l, &buf[0], 10);
         saitek_parse_radiopanel_display(radiopanel->display0r, &buf[11], 10);
         saitek_parse_radiopanel_display(radiopanel->display1l, &buf[22], 10);
@@ -499,37 +1033,51 @@ static void saitek_buf_parse_radiopanel(struct proflight_radiopanel *radiopanel,
                 case 'R':
                         radiopanel->parent->mode = buf[44];
         }
+        SAITEK_OUTPUT_UNLOCK(&radiopanel->parent->output_lock, flags);
+}
+
+static size_t saitek_fill_multipanel_report(struct proflight_multipanel *multipanel, __u8 *report)
+{
+        report[0] = 0; // also: report id
+        memcpy(&(report[1]), multipanel->display0, 5);
+        memcpy(&(report[6]), multipanel->display1, 5);
+        report[11] =
+                          (multipanel->led_hdg ? PROFLIGHT_MULTIPANEL_LIGHT_HDG : 0)
+                        + (multipanel->led_nav ? PROFLIGHT_MULTIPANEL_LIGHT_NAV : 0)
+                        + (multipanel->led_ias ? PROFLIGHT_MULTIPANEL_LIGHT_IAS : 0)
+                        + (multipanel->led_alt ? PROFLIGHT_MULTIPANEL_LIGHT_ALT : 0)
+                        + (multipanel->led_vs  ? PROFLIGHT_MULTIPANEL_LIGHT_VS  : 0)
+                        + (multipanel->led_apr ? PROFLIGHT_MULTIPANEL_LIGHT_APR : 0)
+                        + (multipanel->led_rev ? PROFLIGHT_MULTIPANEL_LIGHT_REV : 0)
+                        + (multipanel->led_ap  ? PROFLIGHT_MULTIPANEL_LIGHT_AP  : 0);
+
+        report[12] = 0;
+
+        return 13;
 }
 
 static int saitek_set_multipanel(struct proflight_multipanel *multipanel)
 {
+        unsigned long flags;
+        size_t len;
         int res = 0;
 
-        multipanel->parent->dmabuf[0] = 0; // also: report id
-        memcpy(&(multipanel->parent->dmabuf[1]), multipanel->display0, 5);
-        memcpy(&(multipanel->parent->dmabuf[6]), multipanel->display1, 5);
-        multipanel->parent->dmabuf[11] =
-                          (multipanel->led_hdg ? MULTIPANEL_LIGHT_HDG : 0)
-                        + (multipanel->led_nav ? MULTIPANEL_LIGHT_NAV : 0)
-                        + (multipanel->led_ias ? MULTIPANEL_LIGHT_IAS : 0)
-                        + (multipanel->led_alt ? MULTIPANEL_LIGHT_ALT : 0)
-                        + (multipanel->led_vs  ? MULTIPANEL_LIGHT_VS  : 0)
-                        + (multipanel->led_apr ? MULTIPANEL_LIGHT_APR : 0)
-                        + (multipanel->led_rev ? MULTIPANEL_LIGHT_REV : 0)
-                        + (multipanel->led_ap  ? MULTIPANEL_LIGHT_AP  : 0);
-
-        multipanel->parent->dmabuf[12] = 0;
-
-        res = hid_hw_raw_request(multipanel->parent->hdev,
-                        multipanel->parent->dmabuf[0], multipanel->parent->dmabuf,
-                        13, HID_FEATURE_REPORT, HID_REQ_SET_REPORT);
-        
+        SAITEK_OUTPUT_LOCK(&multipanel->parent->output_lock, flags);
+        len = saitek_fill_multipanel_report(multipanel, multipanel->parent->dmabuf);
+        saitek_proflight_animate(multipanel->parent, multipanel->parent->dmabuf, 2);
+        SAITEK_OUTPUT_UNLOCK(&multipanel->parent->output_lock, flags);
+        trace_saitek_set_report(multipanel->parent->hdev, multipanel->parent->dmabuf, len, 0);
+
+        res = saitek_proflight_send_report(multipanel->parent, len);
+
         return res;
 }
 
 static void saitek_buf_parse_multipanel(struct proflight_multipanel *multipanel,
                 const char *buf, size_t count)
 {
+        unsigned long flags;
+
         if (count < 22) {
                 hid_err(multipanel->parent->hdev,
                                 "Saitek ProFlight Multi Panel state ('%.*s') too short (%li).\n",
@@ -540,6 +1088,7 @@ static void saitek_buf_parse_multipanel(struct proflight_multipanel *multipanel,
                                 "Saitek ProFlight Multi Panel state ('%.*s') too long (%li).\n",
                                 (int)count, buf, count);
         }
+        SAITEK_OUTPUT_LOCK(&multipanel->parent->output_lock, flags);
         saitek_parse_multipanel_display(multipanel->display0, &buf[0], 5);
         saitek_parse_multipanel_display(multipanel->display1, &buf[6], 5);
 #define SET_IF_CHAR_BIN(variable,value) variable = value == '1' ? 1 : value == '0' ? 0 : variable
@@ -557,14 +1106,13 @@ static void saitek_buf_parse_multipanel(struct proflight_multipanel *multipanel,
                 case 'R':
                         multipanel->parent->mode = buf[21];
         }
+        SAITEK_OUTPUT_UNLOCK(&multipanel->parent->output_lock, flags);
 }
 
-static int saitek_set_switchpanel(struct proflight_switchpanel *switchpanel)
+static size_t saitek_fill_switchpanel_report(struct proflight_switchpanel *switchpanel, __u8 *report)
 {
-        int res = 0;
-
-        switchpanel->parent->dmabuf[0] = 0; // also: report id
-        switchpanel->parent->dmabuf[1] = (
+        report[0] = 0; // also: report id
+        report[1] = (
                         (switchpanel->led_n == '\000') ? 0x00 :
                         (switchpanel->led_n == 'G') ? 0x01 :
                         (switchpanel->led_n == 'R') ? 0x08 :
@@ -577,17 +1125,31 @@ static int saitek_set_switchpanel(struct proflight_switchpanel *switchpanel)
                         (switchpanel->led_r == 'G') ? 0x04 :
                         (switchpanel->led_r == 'R') ? 0x20 :
                         (switchpanel->led_r == 'Y') ? 0x24 : 0x00);
-                        
-        res = hid_hw_raw_request(switchpanel->parent->hdev,
-                        switchpanel->parent->dmabuf[0], switchpanel->parent->dmabuf,
-                        2, HID_FEATURE_REPORT, HID_REQ_SET_REPORT);
-        
+
+        return 2;
+}
+
+static int saitek_set_switchpanel(struct proflight_switchpanel *switchpanel)
+{
+        unsigned long flags;
+        size_t len;
+        int res = 0;
+
+        SAITEK_OUTPUT_LOCK(&switchpanel->parent->output_lock, flags);
+        len = saitek_fill_switchpanel_report(switchpanel, switchpanel->parent->dmabuf);
+        SAITEK_OUTPUT_UNLOCK(&switchpanel->parent->output_lock, flags);
+        trace_saitek_set_report(switchpanel->parent->hdev, switchpanel->parent->dmabuf, len, 0);
+
+        res = saitek_proflight_send_report(switchpanel->parent, len);
+
         return res;
 }
 
 static void saitek_buf_parse_switchpanel(struct proflight_switchpanel *switchpanel,
                 const char *buf, size_t count)
 {
+        unsigned long flags;
+
         if (count < 3) {
                 hid_err(switchpanel->parent->hdev,
                                 "Saitek ProFlight Switch Panel state ('%.*s') too short (%li).\n",
@@ -603,161 +1165,2213 @@ static void saitek_buf_parse_switchpanel(struct proflight_switchpanel *switchpan
         if ((value) == 'G' || (value) == 'R' || (value) == 'Y' || (value) == '-') \
                 variable = ((value) != '-') ? (value) : '\000';
         
+        SAITEK_OUTPUT_LOCK(&switchpanel->parent->output_lock, flags);
         SET_IF_CHAR_COLOR(switchpanel->led_n,buf[0]);
         SET_IF_CHAR_COLOR(switchpanel->led_l,buf[1]);
         SET_IF_CHAR_COLOR(switchpanel->led_r,buf[2]);
+        SAITEK_OUTPUT_UNLOCK(&switchpanel->parent->output_lock, flags);
 
 #undef SET_IF_CHAR_COLOR
 }
 
-static ssize_t saitek_proflight_show(struct device *dev,
-                struct device_attribute *attr, char *buf)
+/*
+ * Replace the display/LED shadow with a frame (feature report layout, without
+ * the report ID). Called with the output lock held.
+ */
+static void saitek_frame_load_radiopanel(struct proflight_radiopanel *radiopanel,
+                const __u8 *frame)
 {
-        struct proflight *driver_data;
-        ssize_t ret_val;
+        memcpy(radiopanel->display0l, &frame[0], 5);
+        memcpy(radiopanel->display0r, &frame[5], 5);
+        memcpy(radiopanel->display1l, &frame[10], 5);
+        memcpy(radiopanel->display1r, &frame[15], 5);
+}
 
-        driver_data = dev_get_drvdata(dev);
-        if (!driver_data) {
-                printk(KERN_ERR "Cannot find Saitek ProFlight device data.\n");
-                return -EIO;
-        }
+static void saitek_frame_load_multipanel(struct proflight_multipanel *multipanel,
+                const __u8 *frame)
+{
+        memcpy(multipanel->display0, &frame[0], 5);
+        memcpy(multipanel->display1, &frame[5], 5);
+        multipanel->led_hdg = CHECK(frame[10] & PROFLIGHT_MULTIPANEL_LIGHT_HDG);
+        multipanel->led_nav = CHECK(frame[10] & PROFLIGHT_MULTIPANEL_LIGHT_NAV);
+        multipanel->led_ias = CHECK(frame[10] & PROFLIGHT_MULTIPANEL_LIGHT_IAS);
+        multipanel->led_alt = CHECK(frame[10] & PROFLIGHT_MULTIPANEL_LIGHT_ALT);
+        multipanel->led_vs  = CHECK(frame[10] & PROFLIGHT_MULTIPANEL_LIGHT_VS);
+        multipanel->led_apr = CHECK(frame[10] & PROFLIGHT_MULTIPANEL_LIGHT_APR);
+        multipanel->led_rev = CHECK(frame[10] & PROFLIGHT_MULTIPANEL_LIGHT_REV);
+        multipanel->led_ap  = CHECK(frame[10] & PROFLIGHT_MULTIPANEL_LIGHT_AP);
+}
 
-        SAITEK_LOCK_READ(driver_data->lock);
-        switch(driver_data->product_id) {
+static void saitek_frame_load_switchpanel(struct proflight_switchpanel *switchpanel,
+                const __u8 *frame)
+{
+#define FRAME_COLOR(green,red) \
+        (((frame[0] & (green)) && (frame[0] & (red))) ? 'Y' : \
+         (frame[0] & (green)) ? 'G' : (frame[0] & (red)) ? 'R' : '\000')
+
+        switchpanel->led_n = FRAME_COLOR(PROFLIGHT_SWITCHPANEL_LIGHT_N_GREEN,
+                                         PROFLIGHT_SWITCHPANEL_LIGHT_N_RED);
+        switchpanel->led_l = FRAME_COLOR(PROFLIGHT_SWITCHPANEL_LIGHT_L_GREEN,
+                                         PROFLIGHT_SWITCHPANEL_LIGHT_L_RED);
+        switchpanel->led_r = FRAME_COLOR(PROFLIGHT_SWITCHPANEL_LIGHT_R_GREEN,
+                                         PROFLIGHT_SWITCHPANEL_LIGHT_R_RED);
+
+#undef FRAME_COLOR
+}
+
+static void saitek_proflight_load_frame(struct proflight *driver_data, const __u8 *frame)
+{
+        switch (driver_data->product_id) {
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
-                ret_val = saitek_buf_format_radiopanel(buf,
-                                driver_data->data.radiopanel);
+                saitek_frame_load_radiopanel(driver_data->data.radiopanel, frame);
                 break;
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
-                ret_val = saitek_buf_format_multipanel(buf,
-                                driver_data->data.multipanel);
+                saitek_frame_load_multipanel(driver_data->data.multipanel, frame);
                 break;
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
-                ret_val = saitek_buf_format_switchpanel(buf,
-                                driver_data->data.switchpanel);
+                saitek_frame_load_switchpanel(driver_data->data.switchpanel, frame);
                 break;
-        default:
-                ret_val = -ENXIO;
         }
-        SAITEK_UNLOCK_READ(driver_data->lock);
-
-        return ret_val;
 }
 
-static ssize_t saitek_proflight_store(struct device *dev,
-                struct device_attribute *attr, const char *buf, size_t count)
+/*
+ * Renders a value right-aligned on 5 digits of a Multi Panel display.
+ */
+static void saitek_render_multipanel_display(char *display, int value)
 {
-        struct proflight *driver_data;
-        ssize_t ret_val;
-        size_t true_count;
+        unsigned int v = (value < 0) ? -(unsigned int)value : value;
+        int i = 4;
 
-        driver_data = dev_get_drvdata(dev);
-        if (!driver_data) {
-                printk(KERN_ERR "Cannot find Saitek ProFlight device data.\n");
-                return -EIO;
+        memset(display, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+        do {
+                display[i--] = v % 10;
+                v /= 10;
+        } while (v && i >= 0);
+        if (value < 0 && i >= 0)
+                display[i] = PROFLIGHT_PANEL_DIGIT_MINUS;
+}
+
+/*
+ * Shows the autopilot model for the selected position: ALT and VS on both
+ * rows in the ALT and VS positions, the selected value on the upper row
+ * otherwise. Called with the output lock held.
+ */
+static void saitek_autopilot_render(struct proflight_multipanel *multipanel)
+{
+        switch (multipanel->mode) {
+        case PROFLIGHT_MULTIPANEL_MODE_ALT:
+        case PROFLIGHT_MULTIPANEL_MODE_VS:
+                saitek_render_multipanel_display(multipanel->display0,
+                                atomic_read(&multipanel->ap[PROFLIGHT_MULTIPANEL_MODE_ALT].value));
+                saitek_render_multipanel_display(multipanel->display1,
+                                atomic_read(&multipanel->ap[PROFLIGHT_MULTIPANEL_MODE_VS].value));
+                break;
+        case PROFLIGHT_MULTIPANEL_MODE_IAS:
+        case PROFLIGHT_MULTIPANEL_MODE_HDG:
+        case PROFLIGHT_MULTIPANEL_MODE_CRS:
+                saitek_render_multipanel_display(multipanel->display0,
+                                atomic_read(&multipanel->ap[multipanel->mode].value));
+                memset(multipanel->display1, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+                break;
         }
+}
 
+static void saitek_autopilot_init(struct proflight_multipanel *multipanel)
+{
+#define SAITEK_AUTOPILOT_DEFAULT(pos, step_, limit_, min_, max_) \
+        multipanel->ap[PROFLIGHT_MULTIPANEL_MODE_ ## pos].step = step_; \
+        multipanel->ap[PROFLIGHT_MULTIPANEL_MODE_ ## pos].limit.mode = SAITEK_LIMIT_ ## limit_; \
+        multipanel->ap[PROFLIGHT_MULTIPANEL_MODE_ ## pos].limit.min = min_; \
+        multipanel->ap[PROFLIGHT_MULTIPANEL_MODE_ ## pos].limit.max = max_;
+
+        SAITEK_AUTOPILOT_DEFAULT(ALT, 100, CLAMP,     0, 50000);
+        SAITEK_AUTOPILOT_DEFAULT(VS,  100, CLAMP, -9900,  9900);
+        SAITEK_AUTOPILOT_DEFAULT(IAS,   1, CLAMP,     0,   999);
+        SAITEK_AUTOPILOT_DEFAULT(HDG,   1, WRAP,      0,   359);
+        SAITEK_AUTOPILOT_DEFAULT(CRS,   1, WRAP,      0,   359);
+
+#undef SAITEK_AUTOPILOT_DEFAULT
+}
+
+static int saitek_mod(int value, int n)
+{
+        value %= n;
+        return (value < 0) ? value + n : value;
+}
+
+/*
+ * Turns a radio value of the given selector position by delta steps of the
+ * outer (MHz, ADF hundreds, XPDR first two digits) or the inner knob (channel,
+ * ADF kHz, XPDR last two digits), wrapping around within the band and staying
+ * on its channel raster. A delta of 0 just brings a value onto the raster.
+ */
+static int saitek_radio_tune(int mode, int value, int outer, int delta, int com_833)
+{
+        int mhz = value / 1000;
+        int khz = value % 1000;
+        int ch;
+
+        switch (mode) {
+        case PROFLIGHT_RADIOPANEL_MODE_COM1:
+        case PROFLIGHT_RADIOPANEL_MODE_COM2: // 118.000 - 136.975 MHz
+                if (outer) {
+                        mhz = 118 + saitek_mod(mhz - 118 + delta, 19);
+                } else if (com_833) { // .000 .005 .010 .015 .025 .030 ... .090
+                        ch = khz / 25 * 4 + min(khz % 25 / 5, 3);
+                        ch = saitek_mod(ch + delta, 160);
+                        khz = ch / 4 * 25 + ch % 4 * 5;
+                } else {
+                        khz = saitek_mod(khz / 25 + delta, 40) * 25;
+                }
+                return mhz * 1000 + khz;
+        case PROFLIGHT_RADIOPANEL_MODE_NAV1:
+        case PROFLIGHT_RADIOPANEL_MODE_NAV2:
+        case PROFLIGHT_RADIOPANEL_MODE_DME: // 108.00 - 117.95 MHz
+                if (outer)
+                        mhz = 108 + saitek_mod(mhz - 108 + delta, 10);
+                else
+                        khz = saitek_mod(khz / 50 + delta, 20) * 50;
+                return mhz * 1000 + khz;
+        case PROFLIGHT_RADIOPANEL_MODE_ADF: // 190 - 1799 kHz
+                return 190 + saitek_mod(value - 190 + delta * (outer ? 100 : 1), 1610);
+        case PROFLIGHT_RADIOPANEL_MODE_XPDR: // 0000 - 7777
+                if (outer)
+                        return (saitek_mod((value >> 6) + delta, 64) << 6) | (value & 077);
+                return (value & 07700) | saitek_mod(value + delta, 64);
+        }
+
+        return value;
+}
+
+/*
+ * Whether value lies within the band of the given selector position (not
+ * necessarily on its channel raster).
+ */
+static bool saitek_radio_in_band(int mode, int value)
+{
+        switch (mode) {
+        case PROFLIGHT_RADIOPANEL_MODE_COM1:
+        case PROFLIGHT_RADIOPANEL_MODE_COM2:
+                return value >= 118000 && value < 137000;
+        case PROFLIGHT_RADIOPANEL_MODE_NAV1:
+        case PROFLIGHT_RADIOPANEL_MODE_NAV2:
+        case PROFLIGHT_RADIOPANEL_MODE_DME:
+                return value >= 108000 && value < 118000;
+        case PROFLIGHT_RADIOPANEL_MODE_ADF:
+                return value >= 190 && value <= 1799;
+        case PROFLIGHT_RADIOPANEL_MODE_XPDR:
+                return value >= 0 && value <= 07777;
+        }
+
+        return false;
+}
+
+/*
+ * Renders a radio value on 5 digits of a Radio Panel display: MHz with two
+ * decimals for COM, NAV and DME (118.02 for 118.025), kHz for ADF, the
+ * squawk code for XPDR.
+ */
+static void saitek_render_radiopanel_display(char *display, int mode, int value)
+{
+        int i;
+
+        memset(display, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+        switch (mode) {
+        case PROFLIGHT_RADIOPANEL_MODE_COM1:
+        case PROFLIGHT_RADIOPANEL_MODE_COM2:
+        case PROFLIGHT_RADIOPANEL_MODE_NAV1:
+        case PROFLIGHT_RADIOPANEL_MODE_NAV2:
+        case PROFLIGHT_RADIOPANEL_MODE_DME:
+                value /= 10;
+                for (i = 4; i >= 0; i--, value /= 10)
+                        display[i] = value % 10;
+                display[2] |= PROFLIGHT_PANEL_DIGIT_DOT;
+                break;
+        case PROFLIGHT_RADIOPANEL_MODE_ADF:
+                for (i = 4; value && i >= 0; i--, value /= 10)
+                        display[i] = value % 10;
+                break;
+        case PROFLIGHT_RADIOPANEL_MODE_XPDR:
+                for (i = 4; i > 0; i--, value >>= 3)
+                        display[i] = value & 7;
+                break;
+        }
+}
+
+/*
+ * Shows active (left) and standby (right) value of the position selected on
+ * each row. Called with the output lock held.
+ */
+static void saitek_tuner_render(struct proflight_radiopanel *radiopanel)
+{
+        const struct saitek_radio_value *radio0 = &radiopanel->radio[radiopanel->mode0];
+        const struct saitek_radio_value *radio1 = &radiopanel->radio[radiopanel->mode1];
+
+        saitek_render_radiopanel_display(radiopanel->display0l, radiopanel->mode0, radio0->active);
+        saitek_render_radiopanel_display(radiopanel->display0r, radiopanel->mode0, radio0->standby);
+        saitek_render_radiopanel_display(radiopanel->display1l, radiopanel->mode1, radio1->active);
+        saitek_render_radiopanel_display(radiopanel->display1r, radiopanel->mode1, radio1->standby);
+}
+
+static void saitek_tuner_init(struct proflight_radiopanel *radiopanel)
+{
+#define SAITEK_TUNER_DEFAULT(pos, value) \
+        radiopanel->radio[PROFLIGHT_RADIOPANEL_MODE_ ## pos].active = value; \
+        radiopanel->radio[PROFLIGHT_RADIOPANEL_MODE_ ## pos].standby = value;
+
+        SAITEK_TUNER_DEFAULT(COM1, 118000);
+        SAITEK_TUNER_DEFAULT(COM2, 118000);
+        SAITEK_TUNER_DEFAULT(NAV1, 108000);
+        SAITEK_TUNER_DEFAULT(NAV2, 108000);
+        SAITEK_TUNER_DEFAULT(ADF,     190);
+        SAITEK_TUNER_DEFAULT(DME,  108000);
+        SAITEK_TUNER_DEFAULT(XPDR,  01200); // VFR
+
+#undef SAITEK_TUNER_DEFAULT
+}
+
+/*
+ * Moves the accumulated counters to the copy and zeroes them in one atomic
+ * exchange each, so that concurrent readers neither lose nor double-count
+ * a detent or a press.
+ */
+#define SAITEK_DRAIN(copy, panel, counter) \
+        atomic_set(&(copy)->counter, atomic_xchg(&(panel)->counter, 0))
+
+static void saitek_drain_radiopanel(struct proflight_radiopanel *copy,
+                struct proflight_radiopanel *radiopanel)
+{
+        SAITEK_DRAIN(copy, radiopanel, aactstby0);
+        SAITEK_DRAIN(copy, radiopanel, aactstby1);
+        SAITEK_DRAIN(copy, radiopanel, innerknob0);
+        SAITEK_DRAIN(copy, radiopanel, outerknob0);
+        SAITEK_DRAIN(copy, radiopanel, innerknob1);
+        SAITEK_DRAIN(copy, radiopanel, outerknob1);
+}
+
+static void saitek_drain_multipanel(struct proflight_multipanel *copy,
+                struct proflight_multipanel *multipanel)
+{
+        SAITEK_DRAIN(copy, multipanel, flaps);
+        SAITEK_DRAIN(copy, multipanel, pitch_trim);
+        SAITEK_DRAIN(copy, multipanel, knob);
+        SAITEK_DRAIN(copy, multipanel, ahdg);
+        SAITEK_DRAIN(copy, multipanel, anav);
+        SAITEK_DRAIN(copy, multipanel, aias);
+        SAITEK_DRAIN(copy, multipanel, aalt);
+        SAITEK_DRAIN(copy, multipanel, avs);
+        SAITEK_DRAIN(copy, multipanel, aapr);
+        SAITEK_DRAIN(copy, multipanel, arev);
+        SAITEK_DRAIN(copy, multipanel, aap);
+}
+
+static void saitek_drain_switchpanel(struct proflight_switchpanel *copy,
+                struct proflight_switchpanel *switchpanel)
+{
+        // nothing accumulated
+}
+
+#undef SAITEK_DRAIN
+
+/*
+ * Takes a consistent copy of the panel state for formatting: the copy is
+ * retried whenever it raced with an input report (the output lock keeps the
+ * display/LED shadow from tearing under a concurrent store). In 'R' mode the
+ * accumulators are then drained into the copy.
+ */
+#define SAITEK_DEFINE_SNAPSHOT(panel) \
+static void saitek_snapshot_ ## panel(struct proflight_ ## panel *copy, \
+                struct proflight_ ## panel *panel) \
+{ \
+        SAITEK_INPUT_LOCK_TYPE *lock = &panel->parent->input_lock; \
+        SAITEK_OUTPUT_LOCK_TYPE *olock = &panel->parent->output_lock; \
+        unsigned long oflags; \
+        unsigned int seq; \
+ \
+        do { \
+                seq = SAITEK_INPUT_READ_BEGIN(lock); \
+                SAITEK_OUTPUT_LOCK(olock, oflags); \
+                *copy = *panel; \
+                SAITEK_OUTPUT_UNLOCK(olock, oflags); \
+        } while (SAITEK_INPUT_READ_RETRY(lock, seq)); \
+        if (panel->parent->mode == 'R') \
+                saitek_drain_ ## panel(copy, panel); \
+}
+
+SAITEK_DEFINE_SNAPSHOT(radiopanel)
+SAITEK_DEFINE_SNAPSHOT(multipanel)
+SAITEK_DEFINE_SNAPSHOT(switchpanel)
+
+#undef SAITEK_DEFINE_SNAPSHOT
+
+static ssize_t saitek_proflight_show(struct device *dev,
+                struct device_attribute *attr, char *buf)
+{
+        struct proflight *driver_data;
+        union {
+                struct proflight_radiopanel radiopanel;
+                struct proflight_multipanel multipanel;
+                struct proflight_switchpanel switchpanel;
+        } copy;
+        ssize_t ret_val;
+        u64 t0, t1, t2, tf = 0;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data) {
+                printk(KERN_ERR "Cannot find Saitek ProFlight device data.\n");
+                return -EIO;
+        }
+
+        t0 = ktime_get_ns();
+        SAITEK_LOCK_READ(driver_data->lock);
+        t1 = ktime_get_ns();
+        switch(driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                saitek_snapshot_radiopanel(&copy.radiopanel,
+                                driver_data->data.radiopanel);
+                tf = ktime_get_ns();
+                ret_val = saitek_buf_format_radiopanel(buf, &copy.radiopanel);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                saitek_snapshot_multipanel(&copy.multipanel,
+                                driver_data->data.multipanel);
+                tf = ktime_get_ns();
+                ret_val = saitek_buf_format_multipanel(buf, &copy.multipanel);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                saitek_snapshot_switchpanel(&copy.switchpanel,
+                                driver_data->data.switchpanel);
+                tf = ktime_get_ns();
+                ret_val = saitek_buf_format_switchpanel(buf, &copy.switchpanel);
+                break;
+        default:
+                ret_val = -ENXIO;
+        }
+        t2 = ktime_get_ns();
+        SAITEK_UNLOCK_READ(driver_data->lock);
+        saitek_hist_add(&driver_data->stats.show_wait, t1 - t0);
+        saitek_hist_add(&driver_data->stats.show_hold, t2 - t1);
+        if (tf)
+                saitek_hist_add(&driver_data->stats.format, t2 - tf);
+
+        return ret_val;
+}
+
+/*
+ * Builds the feature report for the panel. Called with the output lock held.
+ */
+static size_t saitek_proflight_fill_report(struct proflight *driver_data, __u8 *report)
+{
+        switch(driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                return saitek_fill_radiopanel_report(driver_data->data.radiopanel, report);
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                return saitek_fill_multipanel_report(driver_data->data.multipanel, report);
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                return saitek_fill_switchpanel_report(driver_data->data.switchpanel, report);
+        }
+
+        return 0;
+}
+
+static void saitek_state_write_begin(struct proflight_state *state)
+{
+        WRITE_ONCE(state->seq, state->seq + 1);
+        smp_wmb();
+}
+
+static void saitek_state_write_end(struct proflight_state *state)
+{
+        smp_wmb();
+        WRITE_ONCE(state->seq, state->seq + 1);
+}
+
+/*
+ * Copies the display/LED shadow (and the operating mode) to the state page.
+ */
+static void saitek_proflight_publish_frame(struct proflight *driver_data)
+{
+        struct proflight_chardev *chardev = driver_data->chardev;
+        __u8 report[SAITEK_HID_BUF_LEN];
+        unsigned long flags;
+        size_t len;
+        char mode;
+
+        if (!chardev)
+                return;
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        len = saitek_proflight_fill_report(driver_data, report);
+        mode = driver_data->mode;
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        if (!len)
+                return;
+
+        spin_lock_irqsave(&chardev->lock, flags);
+        saitek_state_write_begin(chardev->state);
+        memcpy(chardev->state->frame, &report[1], len - 1);
+        chardev->state->mode = mode;
+        saitek_state_write_end(chardev->state);
+        spin_unlock_irqrestore(&chardev->lock, flags);
+}
+
+/*
+ * Pushes the current display/LED shadow to the device. Runs from the output
+ * work item, so that writers never wait for the USB control transfer. Work
+ * queued several times before it gets to run is executed once, with the
+ * latest shadow.
+ */
+static void saitek_proflight_output_work(struct work_struct *work)
+{
+        struct proflight *driver_data;
+        int res;
+
+        driver_data = container_of(work, struct proflight, output_work);
+        switch(driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                res = saitek_set_radiopanel(driver_data->data.radiopanel);
+                if (res < 0)
+                        hid_err(driver_data->hdev, "Error setting Saitek ProFlight Radio Panel: %d.\n", res);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                res = saitek_set_multipanel(driver_data->data.multipanel);
+                if (res < 0)
+                        hid_err(driver_data->hdev, "Error setting Saitek ProFlight Multi Panel: %d.\n", res);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                res = saitek_set_switchpanel(driver_data->data.switchpanel);
+                if (res < 0)
+                        hid_err(driver_data->hdev, "Error setting Saitek ProFlight Switch Panel: %d.\n", res);
+                break;
+        }
+}
+
+static void saitek_proflight_schedule_output(struct proflight *driver_data)
+{
+        if (!queue_work(system_highpri_wq, &driver_data->output_work))
+                atomic_inc(&driver_data->frames_coalesced); // merged into the pending one
+}
+
+static ssize_t saitek_proflight_store(struct device *dev,
+                struct device_attribute *attr, const char *buf, size_t count)
+{
+        struct proflight *driver_data;
+        ssize_t ret_val;
+        size_t true_count;
+        u64 t0, t1, t2;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data) {
+                printk(KERN_ERR "Cannot find Saitek ProFlight device data.\n");
+                return -EIO;
+        }
+
+        trace_saitek_store(driver_data->hdev, attr->attr.name, count);
         true_count = count;
         if (count > 0 && buf[count- 1] == '\n')
                 true_count--; // ignore trailing new line character
-        SAITEK_LOCK_WRITE(driver_data->lock);
+        t0 = ktime_get_ns();
+        SAITEK_LOCK_READ(driver_data->lock);
+        t1 = ktime_get_ns();
+        if (!driver_data->initialized) {
+                SAITEK_UNLOCK_READ(driver_data->lock);
+                return -ENODEV;
+        }
+        ret_val = count; // informing the caller that we consumed the whole buffer
         switch(driver_data->product_id) {
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
                 saitek_buf_parse_radiopanel(driver_data->data.radiopanel, buf, true_count);
-                ret_val = saitek_set_radiopanel(driver_data->data.radiopanel);
-                if (ret_val < 0)
-                        printk(KERN_ERR "Error setting Saitek ProFlight Radio Panel: %ld.\n", ret_val);
-                else
-                        ret_val = count; // informing the caller that we consumed the whole buffer
                 break;
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
                 saitek_buf_parse_multipanel(driver_data->data.multipanel, buf, true_count);
-                ret_val = saitek_set_multipanel(driver_data->data.multipanel);
-                if (ret_val < 0)
-                        printk(KERN_ERR "Error setting Saitek ProFlight Multi Panel: %ld.\n", ret_val);
-                else
-                        ret_val = count; // informing the caller that we consumed the whole buffer
                 break;
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
                 saitek_buf_parse_switchpanel(driver_data->data.switchpanel, buf, true_count);
-                ret_val = saitek_set_switchpanel(driver_data->data.switchpanel);
-                if (ret_val < 0)
-                        printk(KERN_ERR "Error setting Saitek ProFlight Switch Panel: %ld.\n", ret_val);
-                else
-                        ret_val = count; // informing the caller that we consumed the whole buffer
                 break;
         default:
                 ret_val = -ENXIO;
         }
-        SAITEK_UNLOCK_WRITE(driver_data->lock);
+        if (ret_val >= 0) {
+                saitek_hist_add(&driver_data->stats.parse, ktime_get_ns() - t1);
+                saitek_proflight_publish_frame(driver_data);
+                saitek_proflight_schedule_output(driver_data);
+        }
+        t2 = ktime_get_ns();
+        SAITEK_UNLOCK_READ(driver_data->lock);
+        saitek_hist_add(&driver_data->stats.store_wait, t1 - t0);
+        saitek_hist_add(&driver_data->stats.store_hold, t2 - t1);
+
+        return ret_val;
+}
+
+static DEVICE_ATTR(proflight,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH,
+                saitek_proflight_show, saitek_proflight_store);
+
+#define SAITEK_DEFINE_COUNTER_ATTR(counter) \
+static ssize_t counter ## _show(struct device *dev, \
+                struct device_attribute *attr, char *buf) \
+{ \
+        struct proflight *driver_data = dev_get_drvdata(dev); \
+ \
+        if (!driver_data) \
+                return -EIO; \
+        return sysfs_emit(buf, "%d\n", atomic_read(&driver_data->counter)); \
+} \
+static DEVICE_ATTR_RO(counter);
+
+SAITEK_DEFINE_COUNTER_ATTR(frames_sent)
+SAITEK_DEFINE_COUNTER_ATTR(frames_skipped)
+SAITEK_DEFINE_COUNTER_ATTR(frames_coalesced)
+SAITEK_DEFINE_COUNTER_ATTR(events_dropped)
+
+#undef SAITEK_DEFINE_COUNTER_ATTR
+
+/*
+ * Always drains the accumulated counters, regardless of the 'R'/'N' mode:
+ * Radio Panel - act/stby presses (upper, lower), inner and outer knob of the
+ * upper, then of the lower row;
+ * Multi Panel - flaps, pitch trim, knob, then HDG NAV IAS ALT VS APR REV AP
+ * presses.
+ */
+static ssize_t deltas_show(struct device *dev,
+                struct device_attribute *attr, char *buf)
+{
+        struct proflight *driver_data;
+        union {
+                struct proflight_radiopanel radiopanel;
+                struct proflight_multipanel multipanel;
+        } copy;
+        ssize_t ret_val;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+
+        SAITEK_LOCK_READ(driver_data->lock);
+        switch(driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                saitek_drain_radiopanel(&copy.radiopanel, driver_data->data.radiopanel);
+                ret_val = sysfs_emit(buf, "%d %d %d %d %d %d\n",
+                                atomic_read(&copy.radiopanel.aactstby0),
+                                atomic_read(&copy.radiopanel.aactstby1),
+                                atomic_read(&copy.radiopanel.innerknob0),
+                                atomic_read(&copy.radiopanel.outerknob0),
+                                atomic_read(&copy.radiopanel.innerknob1),
+                                atomic_read(&copy.radiopanel.outerknob1));
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                saitek_drain_multipanel(&copy.multipanel, driver_data->data.multipanel);
+                ret_val = sysfs_emit(buf, "%d %d %d %d %d %d %d %d %d %d %d\n",
+                                atomic_read(&copy.multipanel.flaps),
+                                atomic_read(&copy.multipanel.pitch_trim),
+                                atomic_read(&copy.multipanel.knob),
+                                atomic_read(&copy.multipanel.ahdg),
+                                atomic_read(&copy.multipanel.anav),
+                                atomic_read(&copy.multipanel.aias),
+                                atomic_read(&copy.multipanel.aalt),
+                                atomic_read(&copy.multipanel.avs),
+                                atomic_read(&copy.multipanel.aapr),
+                                atomic_read(&copy.multipanel.arev),
+                                atomic_read(&copy.multipanel.aap));
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                ret_val = sysfs_emit(buf, "\n"); // nothing accumulated
+                break;
+        default:
+                ret_val = -ENXIO;
+        }
+        SAITEK_UNLOCK_READ(driver_data->lock);
+
+        return ret_val;
+}
+
+static DEVICE_ATTR(deltas, S_IRUSR | S_IRGRP, deltas_show, NULL);
+
+static const char *const saitek_limit_modes[] = {
+        [SAITEK_LIMIT_CLAMP] = "clamp",
+        [SAITEK_LIMIT_WRAP] = "wrap",
+        [SAITEK_LIMIT_UNBOUNDED] = "unbounded",
+};
+
+/*
+ * Range of every press or detent counter, one per line:
+ * "<code> <clamp|wrap|unbounded> <min> <max> <saturated>", code being the
+ * PROFLIGHT_* event code of the button or encoder and saturated the number of
+ * presses or detents lost at a clamp. Writing "<code> clamp <min> <max>",
+ * "<code> wrap <min> <max>" or "<code> unbounded" changes one of them and
+ * brings its counter into the new range. Ranges wider than the defaults
+ * break the fixed columns of the proflight attribute, see
+ * saitek_buf_format_radiopanel().
+ */
+static ssize_t limits_show(struct device *dev,
+                struct device_attribute *attr, char *buf)
+{
+        struct proflight *driver_data;
+        const struct saitek_decoder *decoder;
+        struct saitek_limit limits[PROFLIGHT_MAX_CODES];
+        unsigned int seq;
+        ssize_t len = 0;
+        int code;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+        decoder = saitek_proflight_decoder(driver_data->product_id);
+        if (!decoder)
+                return -ENXIO;
+
+        do {
+                seq = SAITEK_INPUT_READ_BEGIN(&driver_data->input_lock);
+                memcpy(limits, driver_data->limits, sizeof(limits));
+        } while (SAITEK_INPUT_READ_RETRY(&driver_data->input_lock, seq));
+        for (code = 0; code < PROFLIGHT_MAX_CODES; code++)
+                if (saitek_proflight_has_counter(decoder, code))
+                        len += sysfs_emit_at(buf, len, "%d %s %d %d %d\n", code,
+                                        saitek_limit_modes[limits[code].mode],
+                                        limits[code].min, limits[code].max,
+                                        atomic_read(&driver_data->saturated[code]));
+
+        return len;
+}
+
+static ssize_t limits_store(struct device *dev,
+                struct device_attribute *attr, const char *buf, size_t count)
+{
+        struct proflight *driver_data;
+        const struct saitek_decoder *decoder;
+        struct saitek_limit limit;
+        char mode[16];
+        unsigned long flags;
+        unsigned int code;
+        atomic_t *counter;
+        int n;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+        decoder = saitek_proflight_decoder(driver_data->product_id);
+        if (!decoder)
+                return -ENXIO;
+
+        n = sscanf(buf, "%u %15s %d %d", &code, mode, &limit.min, &limit.max);
+        if (n < 2 || !saitek_proflight_has_counter(decoder, code))
+                return -EINVAL;
+        if (!strcmp(mode, saitek_limit_modes[SAITEK_LIMIT_UNBOUNDED])) {
+                limit.mode = SAITEK_LIMIT_UNBOUNDED;
+                limit.min = INT_MIN;
+                limit.max = INT_MAX;
+        } else if (n == 4 && limit.min < limit.max
+                        && !strcmp(mode, saitek_limit_modes[SAITEK_LIMIT_CLAMP])) {
+                limit.mode = SAITEK_LIMIT_CLAMP;
+        } else if (n == 4 && limit.min < limit.max
+                        && !strcmp(mode, saitek_limit_modes[SAITEK_LIMIT_WRAP])) {
+                limit.mode = SAITEK_LIMIT_WRAP;
+        } else {
+                return -EINVAL;
+        }
+
+        SAITEK_LOCK_READ(driver_data->lock);
+        if (!driver_data->initialized) {
+                SAITEK_UNLOCK_READ(driver_data->lock);
+                return -ENODEV;
+        }
+        // a counted button or encoder is named after its (right/up) bit
+        counter = (atomic_t *)((char *)saitek_proflight_panel(driver_data)
+                        + decoder->controls[code].counter);
+        SAITEK_INPUT_WRITE_BEGIN(&driver_data->input_lock, flags);
+        driver_data->limits[code] = limit;
+        if (limit.mode != SAITEK_LIMIT_UNBOUNDED)
+                atomic_set(counter, saitek_limit_apply(&limit, atomic_read(counter)));
+        SAITEK_INPUT_WRITE_END(&driver_data->input_lock, flags);
+        SAITEK_UNLOCK_READ(driver_data->lock);
+
+        return count;
+}
+
+static DEVICE_ATTR(limits, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH,
+                limits_show, limits_store);
+
+static const char *const saitek_autopilot_names[SAITEK_AUTOPILOT_VALUES] = {
+        [PROFLIGHT_MULTIPANEL_MODE_ALT] = "ALT",
+        [PROFLIGHT_MULTIPANEL_MODE_VS]  = "VS",
+        [PROFLIGHT_MULTIPANEL_MODE_IAS] = "IAS",
+        [PROFLIGHT_MULTIPANEL_MODE_HDG] = "HDG",
+        [PROFLIGHT_MULTIPANEL_MODE_CRS] = "CRS",
+};
+
+/*
+ * Multi Panel only: in-kernel autopilot model. When enabled, knob detents
+ * change the value of the selected position by its step and the displays
+ * follow right away, without a round trip through userspace. Reads as
+ * "enabled <0|1>" and one "<ALT|VS|IAS|HDG|CRS> <value> <step> <clamp|wrap>
+ * <min> <max>" line per position; accepts any of these lines, or just
+ * "<position> <value>", as input.
+ */
+static ssize_t autopilot_show(struct device *dev,
+                struct device_attribute *attr, char *buf)
+{
+        struct proflight *driver_data;
+        struct proflight_multipanel *multipanel;
+        struct saitek_autopilot_value *ap;
+        ssize_t len;
+        int i;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+        if (driver_data->product_id != USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL)
+                return -ENXIO;
+        multipanel = driver_data->data.multipanel;
+
+        len = sysfs_emit(buf, "enabled %d\n", READ_ONCE(multipanel->autopilot));
+        for (i = PROFLIGHT_MULTIPANEL_MODE_ALT; i < SAITEK_AUTOPILOT_VALUES; i++) {
+                ap = &multipanel->ap[i];
+                len += sysfs_emit_at(buf, len, "%s %d %d %s %d %d\n",
+                                saitek_autopilot_names[i], atomic_read(&ap->value),
+                                ap->step, saitek_limit_modes[ap->limit.mode],
+                                ap->limit.min, ap->limit.max);
+        }
+
+        return len;
+}
+
+static ssize_t autopilot_store(struct device *dev,
+                struct device_attribute *attr, const char *buf, size_t count)
+{
+        struct proflight *driver_data;
+        struct proflight_multipanel *multipanel;
+        struct saitek_autopilot_value *ap = NULL;
+        struct saitek_limit limit;
+        char name[8], mode[16];
+        unsigned long flags, oflags;
+        int value, step, n, i;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+        if (driver_data->product_id != USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL)
+                return -ENXIO;
+        multipanel = driver_data->data.multipanel;
+
+        n = sscanf(buf, "%7s %d %d %15s %d %d", name, &value, &step, mode,
+                        &limit.min, &limit.max);
+        if (n < 2)
+                return -EINVAL;
+        if (!strcmp(name, "enabled")) {
+                if (n != 2)
+                        return -EINVAL;
+        } else {
+                for (i = PROFLIGHT_MULTIPANEL_MODE_ALT; i < SAITEK_AUTOPILOT_VALUES; i++)
+                        if (!strcmp(name, saitek_autopilot_names[i]))
+                                ap = &multipanel->ap[i];
+                if (!ap || (n != 2 && n != 6))
+                        return -EINVAL;
+                if (n == 6) {
+                        if (!strcmp(mode, saitek_limit_modes[SAITEK_LIMIT_CLAMP]))
+                                limit.mode = SAITEK_LIMIT_CLAMP;
+                        else if (!strcmp(mode, saitek_limit_modes[SAITEK_LIMIT_WRAP]))
+                                limit.mode = SAITEK_LIMIT_WRAP;
+                        else
+                                return -EINVAL;
+                        if (step <= 0 || limit.min >= limit.max)
+                                return -EINVAL;
+                }
+        }
+
+        SAITEK_LOCK_READ(driver_data->lock);
+        if (!driver_data->initialized) {
+                SAITEK_UNLOCK_READ(driver_data->lock);
+                return -ENODEV;
+        }
+        SAITEK_INPUT_WRITE_BEGIN(&driver_data->input_lock, flags);
+        if (!ap) {
+                multipanel->autopilot = !!value;
+        } else {
+                if (n == 6) {
+                        ap->step = step;
+                        ap->limit = limit;
+                }
+                atomic_set(&ap->value, clamp(value, ap->limit.min, ap->limit.max));
+        }
+        if (multipanel->autopilot) {
+                SAITEK_OUTPUT_LOCK(&driver_data->output_lock, oflags);
+                saitek_autopilot_render(multipanel);
+                SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, oflags);
+        }
+        SAITEK_INPUT_WRITE_END(&driver_data->input_lock, flags);
+
+        if (READ_ONCE(multipanel->autopilot)) {
+                saitek_proflight_publish_frame(driver_data);
+                saitek_proflight_schedule_output(driver_data);
+        }
+        SAITEK_UNLOCK_READ(driver_data->lock);
+
+        return count;
+}
+
+static DEVICE_ATTR(autopilot, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH,
+                autopilot_show, autopilot_store);
+
+static const char *const saitek_radio_names[SAITEK_RADIO_VALUES] = {
+        [PROFLIGHT_RADIOPANEL_MODE_COM1] = "COM1",
+        [PROFLIGHT_RADIOPANEL_MODE_COM2] = "COM2",
+        [PROFLIGHT_RADIOPANEL_MODE_NAV1] = "NAV1",
+        [PROFLIGHT_RADIOPANEL_MODE_NAV2] = "NAV2",
+        [PROFLIGHT_RADIOPANEL_MODE_ADF]  = "ADF",
+        [PROFLIGHT_RADIOPANEL_MODE_DME]  = "DME",
+        [PROFLIGHT_RADIOPANEL_MODE_XPDR] = "XPDR",
+};
+
+/*
+ * Radio Panel only: in-kernel radio tuner. When enabled, the outer and inner
+ * knobs of a row tune the standby value of the position selected on that row,
+ * ACT/STBY swaps it with the active one, and the displays follow right away.
+ * Reads as "enabled <0|1>", "spacing <25|8.33>" and one "<COM1|COM2|NAV1|NAV2|
+ * ADF|DME|XPDR> <active> <standby>" line per position (kHz, XPDR in octal);
+ * accepts any of these lines as input, e.g. for the sim to set the radios.
+ * Values outside the band are rejected, values within it are brought onto
+ * the channel raster.
+ */
+static ssize_t tuner_show(struct device *dev,
+                struct device_attribute *attr, char *buf)
+{
+        struct proflight *driver_data;
+        struct proflight_radiopanel *radiopanel;
+        struct saitek_radio_value radio[SAITEK_RADIO_VALUES];
+        unsigned int seq;
+        ssize_t len;
+        int i;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+        if (driver_data->product_id != USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL)
+                return -ENXIO;
+        radiopanel = driver_data->data.radiopanel;
+
+        do {
+                seq = SAITEK_INPUT_READ_BEGIN(&driver_data->input_lock);
+                memcpy(radio, radiopanel->radio, sizeof(radio));
+        } while (SAITEK_INPUT_READ_RETRY(&driver_data->input_lock, seq));
+
+        len = sysfs_emit(buf, "enabled %d\n", READ_ONCE(radiopanel->tuner));
+        len += sysfs_emit_at(buf, len, "spacing %s\n",
+                        READ_ONCE(radiopanel->com_833) ? "8.33" : "25");
+        for (i = PROFLIGHT_RADIOPANEL_MODE_COM1; i < SAITEK_RADIO_VALUES; i++)
+                len += sysfs_emit_at(buf, len,
+                                (i == PROFLIGHT_RADIOPANEL_MODE_XPDR) ? "%s %04o %04o\n" : "%s %d %d\n",
+                                saitek_radio_names[i], radio[i].active, radio[i].standby);
+
+        return len;
+}
+
+static ssize_t tuner_store(struct device *dev,
+                struct device_attribute *attr, const char *buf, size_t count)
+{
+        struct proflight *driver_data;
+        struct proflight_radiopanel *radiopanel;
+        char name[8], spacing[8];
+        unsigned long flags, oflags;
+        int mode = 0, active = 0, standby = 0, enabled = 0, com_833 = -1;
+        int i;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+        if (driver_data->product_id != USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL)
+                return -ENXIO;
+        radiopanel = driver_data->data.radiopanel;
+
+        if (sscanf(buf, "%7s", name) != 1)
+                return -EINVAL;
+        if (!strcmp(name, "enabled")) {
+                if (sscanf(buf, "%*s %d", &enabled) != 1)
+                        return -EINVAL;
+        } else if (!strcmp(name, "spacing")) {
+                if (sscanf(buf, "%*s %7s", spacing) != 1)
+                        return -EINVAL;
+                if (!strcmp(spacing, "25"))
+                        com_833 = 0;
+                else if (!strcmp(spacing, "8.33"))
+                        com_833 = 1;
+                else
+                        return -EINVAL;
+        } else {
+                for (i = PROFLIGHT_RADIOPANEL_MODE_COM1; i < SAITEK_RADIO_VALUES; i++)
+                        if (!strcmp(name, saitek_radio_names[i]))
+                                mode = i;
+                if (!mode)
+                        return -EINVAL;
+                if (sscanf(buf, (mode == PROFLIGHT_RADIOPANEL_MODE_XPDR) ? "%*s %o %o" : "%*s %d %d",
+                                &active, &standby) != 2)
+                        return -EINVAL;
+                if (!saitek_radio_in_band(mode, active) || !saitek_radio_in_band(mode, standby))
+                        return -EINVAL;
+        }
+
+        SAITEK_LOCK_READ(driver_data->lock);
+        if (!driver_data->initialized) {
+                SAITEK_UNLOCK_READ(driver_data->lock);
+                return -ENODEV;
+        }
+        SAITEK_INPUT_WRITE_BEGIN(&driver_data->input_lock, flags);
+        if (mode) {
+                // onto the channel raster, as if the inner knob had been turned
+                radiopanel->radio[mode].active = saitek_radio_tune(mode, active, 0, 0,
+                                radiopanel->com_833);
+                radiopanel->radio[mode].standby = saitek_radio_tune(mode, standby, 0, 0,
+                                radiopanel->com_833);
+        } else if (com_833 >= 0) {
+                radiopanel->com_833 = com_833;
+        } else {
+                radiopanel->tuner = !!enabled;
+        }
+        if (radiopanel->tuner) {
+                SAITEK_OUTPUT_LOCK(&driver_data->output_lock, oflags);
+                saitek_tuner_render(radiopanel);
+                SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, oflags);
+        }
+        SAITEK_INPUT_WRITE_END(&driver_data->input_lock, flags);
+
+        if (READ_ONCE(radiopanel->tuner)) {
+                saitek_proflight_publish_frame(driver_data);
+                saitek_proflight_schedule_output(driver_data);
+        }
+        SAITEK_UNLOCK_READ(driver_data->lock);
+
+        return count;
+}
+
+static DEVICE_ATTR(tuner, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH,
+                tuner_show, tuner_store);
+
+static const char *const saitek_anim_effects[] = {
+        [SAITEK_ANIM_NONE]    = "none",
+        [SAITEK_ANIM_BLINK]   = "blink",
+        [SAITEK_ANIM_FLASH]   = "flash",
+        [SAITEK_ANIM_MARQUEE] = "marquee",
+};
+
+static const char *const saitek_radiopanel_displays[] = { "0l", "0r", "1l", "1r" };
+static const char *const saitek_multipanel_displays[] = { "0", "1" };
+
+static int saitek_anim_displays(struct proflight *driver_data, const char *const **names)
+{
+        switch (driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                *names = saitek_radiopanel_displays;
+                return ARRAY_SIZE(saitek_radiopanel_displays);
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                *names = saitek_multipanel_displays;
+                return ARRAY_SIZE(saitek_multipanel_displays);
+        }
+
+        return 0;
+}
+
+static int saitek_parse_marquee(char *text, const char *buf, int radio)
+{
+        int len = 0;
+
+        for (; *buf && *buf != '\n'; buf++) {
+                if (*buf == '.' && radio && len > 0) {
+                        text[len - 1] |= PROFLIGHT_PANEL_DIGIT_DOT;
+                        continue;
+                }
+                if (len >= SAITEK_MARQUEE_LEN)
+                        return -EINVAL;
+                if (isdigit(*buf))
+                        text[len++] = *buf - '0';
+                else if (*buf == '-' && !radio)
+                        text[len++] = PROFLIGHT_PANEL_DIGIT_MINUS;
+                else
+                        text[len++] = PROFLIGHT_PANEL_DIGIT_NULL;
+        }
+
+        return len;
+}
+
+/*
+ * Formats a marquee text back the way it was written; buf holds up to
+ * 2 * SAITEK_MARQUEE_LEN characters and the terminating zero.
+ */
+static void saitek_format_marquee(char *buf, const struct saitek_animation *anim)
+{
+        char dig, digflag;
+        int len = 0;
+        int i;
+
+        for (i = 0; i < anim->len; i++) {
+                dig = anim->text[i] & (char)0x0f;
+                digflag = anim->text[i] & (char)0xf0;
+                if (dig == PROFLIGHT_PANEL_DIGIT_MINUS)
+                        buf[len++] = '-';
+                else if (0 <= dig && dig < 10)
+                        buf[len++] = '0' + dig;
+                else
+                        buf[len++] = ' ';
+                if (digflag == (char)PROFLIGHT_PANEL_DIGIT_DOT)
+                        buf[len++] = '.';
+        }
+        buf[len] = 0;
+}
+
+/*
+ * Display animations, run by the kernel on the way to the device, so that
+ * userspace sets them once instead of rewriting the displays at the
+ * animation rate. One line per display ("0l", "0r", "1l", "1r" on the Radio
+ * Panel, "0", "1" on the Multi Panel):
+ *   <display> none
+ *   <display> blink <period ms> <digits, hex mask, 1 - leftmost>
+ *   <display> flash <period ms> <count>   (blinks now and after every change)
+ *   <display> marquee <period ms> <text>  (scrolls when longer than 5 digits)
+ * Blink and flash blank the digits for the second half of every period. The
+ * shadow (proflight and frame attributes) keeps the digits as written.
+ */
+static ssize_t animation_show(struct device *dev,
+                struct device_attribute *attr, char *buf)
+{
+        struct proflight *driver_data;
+        struct saitek_animation anim[SAITEK_ANIM_DISPLAYS];
+        const char *const *names;
+        unsigned long flags;
+        char text[2 * SAITEK_MARQUEE_LEN + 1];
+        ssize_t len = 0;
+        int ndisplays, i;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+        ndisplays = saitek_anim_displays(driver_data, &names);
+        if (!ndisplays)
+                return -ENXIO;
+
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        memcpy(anim, driver_data->anim, sizeof(anim));
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+
+        for (i = 0; i < ndisplays; i++) {
+                len += sysfs_emit_at(buf, len, "%s %s", names[i],
+                                saitek_anim_effects[anim[i].effect]);
+                switch (anim[i].effect) {
+                case SAITEK_ANIM_BLINK:
+                        len += sysfs_emit_at(buf, len, " %u %x", anim[i].period_ms,
+                                        anim[i].mask);
+                        break;
+                case SAITEK_ANIM_FLASH:
+                        len += sysfs_emit_at(buf, len, " %u %u", anim[i].period_ms,
+                                        anim[i].count);
+                        break;
+                case SAITEK_ANIM_MARQUEE:
+                        saitek_format_marquee(text, &anim[i]);
+                        len += sysfs_emit_at(buf, len, " %u %s", anim[i].period_ms, text);
+                        break;
+                }
+                len += sysfs_emit_at(buf, len, "\n");
+        }
+
+        return len;
+}
+
+static ssize_t animation_store(struct device *dev,
+                struct device_attribute *attr, const char *buf, size_t count)
+{
+        struct proflight *driver_data;
+        struct saitek_animation anim = {};
+        const char *const *names;
+        __u8 report[SAITEK_HID_BUF_LEN];
+        unsigned long flags;
+        char name[4], effect[8];
+        int ndisplays, display = -1, radio, n, off = 0, i;
+
+        driver_data = dev_get_drvdata(dev);
+        if (!driver_data)
+                return -EIO;
+        ndisplays = saitek_anim_displays(driver_data, &names);
+        if (!ndisplays)
+                return -ENXIO;
+        radio = (driver_data->product_id == USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL);
+
+        n = sscanf(buf, "%3s %7s %u %n", name, effect, &anim.period_ms, &off);
+        if (n < 2)
+                return -EINVAL;
+        for (i = 0; i < ndisplays; i++)
+                if (!strcmp(name, names[i]))
+                        display = i;
+        for (i = 0; i < ARRAY_SIZE(saitek_anim_effects); i++)
+                if (!strcmp(effect, saitek_anim_effects[i]))
+                        anim.effect = i;
+        if (display < 0 || (anim.effect == SAITEK_ANIM_NONE && strcmp(effect, "none")))
+                return -EINVAL;
+        if (anim.effect != SAITEK_ANIM_NONE) {
+                if (n != 3 || anim.period_ms < SAITEK_MIN_ANIM_PERIOD
+                                || anim.period_ms > SAITEK_MAX_ANIM_PERIOD)
+                        return -EINVAL;
+                switch (anim.effect) {
+                case SAITEK_ANIM_BLINK:
+                        if (sscanf(buf + off, "%x", &anim.mask) != 1 || anim.mask > 0x1f)
+                                return -EINVAL;
+                        break;
+                case SAITEK_ANIM_FLASH:
+                        if (sscanf(buf + off, "%u", &anim.count) != 1 || !anim.count)
+                                return -EINVAL;
+                        break;
+                case SAITEK_ANIM_MARQUEE:
+                        anim.len = saitek_parse_marquee(anim.text, buf + off, radio);
+                        if (anim.len < 0)
+                                return anim.len;
+                        break;
+                }
+        }
+        anim.start_ns = ktime_get_ns();
+
+        SAITEK_LOCK_READ(driver_data->lock);
+        if (!driver_data->initialized) {
+                SAITEK_UNLOCK_READ(driver_data->lock);
+                return -ENODEV;
+        }
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        if (anim.effect == SAITEK_ANIM_FLASH) {
+                // flash right away, and again on the next change
+                saitek_proflight_fill_report(driver_data, report);
+                memcpy(anim.last, &report[1 + 5 * display], 5);
+        }
+        driver_data->anim[display] = anim;
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        saitek_proflight_schedule_output(driver_data);
+        SAITEK_UNLOCK_READ(driver_data->lock);
+
+        return count;
+}
+
+static DEVICE_ATTR(animation, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH,
+                animation_show, animation_store);
+
+static size_t saitek_proflight_frame_len(struct proflight *driver_data)
+{
+        switch (driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                return PROFLIGHT_RADIOPANEL_FRAME_LEN;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                return PROFLIGHT_MULTIPANEL_FRAME_LEN;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                return PROFLIGHT_SWITCHPANEL_FRAME_LEN;
+        }
+
+        return 0;
+}
+
+/*
+ * Binary counterpart of the proflight attribute: the display/LED part of the
+ * feature report, exactly as sent to the device (without the report ID).
+ * Writing a frame replaces the whole display/LED shadow; the operating mode
+ * is left alone.
+ */
+static ssize_t frame_read(struct file *file, struct kobject *kobj,
+                const struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+        struct proflight *driver_data = dev_get_drvdata(kobj_to_dev(kobj));
+        __u8 report[SAITEK_HID_BUF_LEN];
+        unsigned long flags;
+        size_t len;
+
+        if (!driver_data)
+                return -EIO;
+
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        len = saitek_proflight_fill_report(driver_data, report);
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        if (len < 1 || off >= len - 1)
+                return 0;
+        count = min_t(size_t, count, len - 1 - off);
+        memcpy(buf, &report[1 + off], count);
+
+        return count;
+}
+
+static ssize_t frame_write(struct file *file, struct kobject *kobj,
+                const struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+        struct proflight *driver_data = dev_get_drvdata(kobj_to_dev(kobj));
+        unsigned long flags;
+        ssize_t ret_val;
+        size_t len;
+
+        if (!driver_data)
+                return -EIO;
+        if (off != 0)
+                return -EINVAL; // frames are written as a whole
+        trace_saitek_store(driver_data->hdev, attr->attr.name, count);
+
+        SAITEK_LOCK_READ(driver_data->lock);
+        if (!driver_data->initialized) {
+                SAITEK_UNLOCK_READ(driver_data->lock);
+                return -ENODEV;
+        }
+        len = saitek_proflight_frame_len(driver_data);
+        if (!len) {
+                ret_val = -ENXIO;
+        } else if (count != len) {
+                ret_val = -EINVAL;
+        } else {
+                ret_val = count;
+                SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+                saitek_proflight_load_frame(driver_data, buf);
+                SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        }
+        if (ret_val >= 0) {
+                saitek_proflight_publish_frame(driver_data);
+                saitek_proflight_schedule_output(driver_data);
+        }
+        SAITEK_UNLOCK_READ(driver_data->lock);
+
+        return ret_val;
+}
+
+static const BIN_ATTR_RW(frame, PROFLIGHT_FRAME_LEN);
+
+/*
+ * Display/LED pages by selector position, shown as soon as the selector gets
+ * there (see PROFLIGHT_PAGES). A page is written as a whole frame at its own
+ * offset, or several pages as read back; pages never written read as zeros.
+ */
+static ssize_t pages_read(struct file *file, struct kobject *kobj,
+                const struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+        struct proflight *driver_data = dev_get_drvdata(kobj_to_dev(kobj));
+        unsigned long flags;
+
+        if (!driver_data)
+                return -EIO;
+        if (off >= sizeof(driver_data->pages))
+                return 0;
+        count = min_t(size_t, count, sizeof(driver_data->pages) - off);
+
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        memcpy(buf, (__u8 *)driver_data->pages + off, count);
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+
+        return count;
+}
+
+static ssize_t pages_write(struct file *file, struct kobject *kobj,
+                const struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+        struct proflight *driver_data = dev_get_drvdata(kobj_to_dev(kobj));
+        unsigned long flags;
+        size_t len, used;
+        int page, npages, i;
+        bool one;
+
+        if (!driver_data)
+                return -EIO;
+        trace_saitek_store(driver_data->hdev, attr->attr.name, count);
+        len = saitek_proflight_frame_len(driver_data);
+        if (!len)
+                return -ENXIO;
+        if (off % PROFLIGHT_FRAME_LEN != 0 || off + count > sizeof(driver_data->pages))
+                return -EINVAL; // pages are written as a whole
+        page = off / PROFLIGHT_FRAME_LEN;
+        one = count == len;
+        if (one) {
+                // a page, or on page 0 the zero frame dropping them all
+                npages = 1;
+                if (page == 0 && memchr_inv(buf, 0, len))
+                        return -EINVAL;
+        } else {
+                // pages as read back: the frame, then zeros up to PROFLIGHT_FRAME_LEN
+                if (!count || count % PROFLIGHT_FRAME_LEN != 0)
+                        return -EINVAL;
+                npages = count / PROFLIGHT_FRAME_LEN;
+                for (i = 0; i < npages; i++) {
+                        used = page + i ? len : 0; // page 0 (no position) reads as zeros
+                        if (memchr_inv(buf + i * PROFLIGHT_FRAME_LEN + used, 0,
+                                        PROFLIGHT_FRAME_LEN - used))
+                                return -EINVAL;
+                }
+        }
+
+        SAITEK_LOCK_READ(driver_data->lock);
+        if (!driver_data->initialized) {
+                SAITEK_UNLOCK_READ(driver_data->lock);
+                return -ENODEV;
+        }
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        if (one && page == 0) {
+                memset(driver_data->pages, 0, sizeof(driver_data->pages));
+                driver_data->pages_valid = 0;
+        }
+        for (i = 0; i < npages; i++, page++, buf += PROFLIGHT_FRAME_LEN) {
+                if (page == 0)
+                        continue;
+                if (!one && !memchr_inv(buf, 0, len)) {
+                        // a page never written, as read back
+                        memset(driver_data->pages[page], 0, PROFLIGHT_FRAME_LEN);
+                        driver_data->pages_valid &= ~(1ul << page);
+                } else {
+                        memcpy(driver_data->pages[page], buf, len);
+                        driver_data->pages_valid |= 1ul << page;
+                }
+        }
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        SAITEK_UNLOCK_READ(driver_data->lock);
+
+        return count;
+}
+
+static const BIN_ATTR_RW(pages, PROFLIGHT_PAGES * PROFLIGHT_FRAME_LEN);
+
+/*
+ * Output rules applied in the input path (see PROFLIGHT_MAX_RULES). The
+ * table is written as a whole; it reads back without the ignored rules.
+ */
+static ssize_t rules_read(struct file *file, struct kobject *kobj,
+                const struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+        struct proflight *driver_data = dev_get_drvdata(kobj_to_dev(kobj));
+        unsigned int seq;
+        size_t len, n;
+
+        if (!driver_data)
+                return -EIO;
+
+        do {
+                seq = SAITEK_INPUT_READ_BEGIN(&driver_data->input_lock);
+                len = driver_data->nrules * sizeof(struct proflight_rule);
+                n = (off < len) ? min_t(size_t, count, len - off) : 0;
+                memcpy(buf, (char *)driver_data->rules + off, n);
+        } while (SAITEK_INPUT_READ_RETRY(&driver_data->input_lock, seq));
+
+        return n;
+}
+
+static ssize_t rules_write(struct file *file, struct kobject *kobj,
+                const struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+        struct proflight *driver_data = dev_get_drvdata(kobj_to_dev(kobj));
+        const struct proflight_rule *rules = (const struct proflight_rule *)buf;
+        const struct proflight_rule *rule;
+        unsigned long flags;
+        size_t len;
+        int nrules = 0;
+        int i;
+
+        if (!driver_data)
+                return -EIO;
+        trace_saitek_store(driver_data->hdev, attr->attr.name, count);
+        if (off != 0 || count % sizeof(*rules))
+                return -EINVAL; // the table is written as a whole
+        len = saitek_proflight_frame_len(driver_data);
+        if (!len)
+                return -ENXIO;
+        for (i = 0; i < count / sizeof(*rules); i++) {
+                rule = &rules[i];
+                if (rule->type == PROFLIGHT_EV_SYN)
+                        continue;
+                if (rule->type > PROFLIGHT_EV_SEL || rule->code >= PROFLIGHT_MAX_CODES
+                                || rule->flags & ~PROFLIGHT_RULE_ANY_VALUE
+                                || rule->action > PROFLIGHT_RULE_TOGGLE || rule->offset >= len
+                                || memchr_inv(rule->reserved, 0, sizeof(rule->reserved)))
+                        return -EINVAL;
+        }
+
+        SAITEK_LOCK_READ(driver_data->lock);
+        if (!driver_data->initialized) {
+                SAITEK_UNLOCK_READ(driver_data->lock);
+                return -ENODEV;
+        }
+        SAITEK_INPUT_WRITE_BEGIN(&driver_data->input_lock, flags);
+        for (i = 0; i < count / sizeof(*rules); i++)
+                if (rules[i].type != PROFLIGHT_EV_SYN)
+                        driver_data->rules[nrules++] = rules[i];
+        driver_data->nrules = nrules;
+        SAITEK_INPUT_WRITE_END(&driver_data->input_lock, flags);
+        SAITEK_UNLOCK_READ(driver_data->lock);
+
+        return count;
+}
+
+static const BIN_ATTR_RW(rules, PROFLIGHT_MAX_RULES * sizeof(struct proflight_rule));
+
+static const struct bin_attribute *const saitek_proflight_bin_attrs[] = {
+        &bin_attr_frame,
+        &bin_attr_pages,
+        &bin_attr_rules,
+        NULL
+};
+
+static struct attribute *saitek_proflight_attrs[] = {
+        &dev_attr_proflight.attr,
+        &dev_attr_frames_sent.attr,
+        &dev_attr_frames_skipped.attr,
+        &dev_attr_frames_coalesced.attr,
+        &dev_attr_events_dropped.attr,
+        &dev_attr_deltas.attr,
+        &dev_attr_limits.attr,
+        &dev_attr_autopilot.attr,
+        &dev_attr_tuner.attr,
+        &dev_attr_animation.attr,
+        NULL
+};
+
+static const struct attribute_group saitek_proflight_attr_group = {
+        .attrs = saitek_proflight_attrs,
+        .bin_attrs = saitek_proflight_bin_attrs,
+};
+
+/*
+ * debugfs: saitek_proflight/<device>/stats (counters) and
+ * saitek_proflight/<device>/histograms (log2 buckets of durations in ns).
+ */
+static struct dentry *saitek_proflight_debugfs_root;
+
+static int saitek_stats_show(struct seq_file *s, void *unused)
+{
+        struct proflight *driver_data = s->private;
+        struct proflight_stats *stats = &driver_data->stats;
+
+        seq_printf(s, "reports: %lld\n", atomic64_read(&stats->reports));
+        seq_printf(s, "duplicate_reports: %lld\n", atomic64_read(&stats->duplicate_reports));
+        seq_printf(s, "events: %lld\n", atomic64_read(&stats->events));
+        seq_printf(s, "events_dropped: %d\n", atomic_read(&driver_data->events_dropped));
+        seq_printf(s, "clamps: %lld\n", atomic64_read(&stats->clamps));
+        seq_printf(s, "glitches: %lld\n", atomic64_read(&stats->glitches));
+        seq_printf(s, "set_reports: %lld\n", atomic64_read(&stats->set_reports));
+        seq_printf(s, "set_report_failures: %lld\n", atomic64_read(&stats->set_report_failures));
+        seq_printf(s, "bytes_sent: %lld\n", atomic64_read(&stats->bytes_sent));
+        seq_printf(s, "frames_sent: %d\n", atomic_read(&driver_data->frames_sent));
+        seq_printf(s, "frames_skipped: %d\n", atomic_read(&driver_data->frames_skipped));
+        seq_printf(s, "frames_coalesced: %d\n", atomic_read(&driver_data->frames_coalesced));
+        seq_printf(s, "probe_ns: %llu\n", READ_ONCE(stats->probe_ns));
+        seq_printf(s, "probe_to_ready_ns: %llu\n", READ_ONCE(stats->ready_ns));
+
+        return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(saitek_stats);
+
+static void saitek_seq_histogram(struct seq_file *s, const char *name,
+                struct proflight_histogram *hist)
+{
+        s64 count;
+        int i;
+
+        seq_printf(s, "%s:\n", name);
+        for (i = 0; i < SAITEK_HIST_BUCKETS; i++) {
+                count = atomic64_read(&hist->buckets[i]);
+                if (!count)
+                        continue;
+                if (i == SAITEK_HIST_BUCKETS - 1)
+                        seq_printf(s, "  %10llu -            : %lld\n", 1ULL << (i - 1), count);
+                else
+                        seq_printf(s, "  %10llu - %10llu : %lld\n",
+                                        i ? 1ULL << (i - 1) : 0, (1ULL << i) - 1, count);
+        }
+}
+
+static int saitek_histograms_show(struct seq_file *s, void *unused)
+{
+        struct proflight *driver_data = s->private;
+        struct proflight_stats *stats = &driver_data->stats;
+
+        saitek_seq_histogram(s, "hw_request_ns", &stats->hw_request);
+        saitek_seq_histogram(s, "store_wait_ns", &stats->store_wait);
+        saitek_seq_histogram(s, "store_hold_ns", &stats->store_hold);
+        saitek_seq_histogram(s, "show_wait_ns", &stats->show_wait);
+        saitek_seq_histogram(s, "show_hold_ns", &stats->show_hold);
+        saitek_seq_histogram(s, "raw_event_wait_ns", &stats->raw_event_wait);
+        saitek_seq_histogram(s, "raw_event_hold_ns", &stats->raw_event_hold);
+        saitek_seq_histogram(s, "parse_ns", &stats->parse);
+        saitek_seq_histogram(s, "format_ns", &stats->format);
+        saitek_seq_histogram(s, "decode_ns", &stats->decode);
+
+        return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(saitek_histograms);
+
+/*
+ * debugfs failures are not fatal (nor even reported): the driver works the
+ * same without the statistics.
+ */
+static void saitek_proflight_debugfs_create(struct proflight *driver_data)
+{
+        driver_data->debugfs = debugfs_create_dir(dev_name(&driver_data->hdev->dev),
+                        saitek_proflight_debugfs_root);
+        debugfs_create_file("stats", 0444, driver_data->debugfs, driver_data,
+                        &saitek_stats_fops);
+        debugfs_create_file("histograms", 0444, driver_data->debugfs, driver_data,
+                        &saitek_histograms_fops);
+}
+
+static DEFINE_IDA(saitek_proflight_ida);
+
+static unsigned int queue_depth = 256;
+module_param(queue_depth, uint, 0644);
+MODULE_PARM_DESC(queue_depth, "Events queued per open /dev/proflightN file, "
+                "rounded up to a power of 2 (64-65536, default 256).");
+
+static unsigned int debounce_key_us = 5000;
+module_param(debounce_key_us, uint, 0644);
+MODULE_PARM_DESC(debounce_key_us, "Minimum time between two changes of a button "
+                "or switch, in microseconds (0 - no debouncing, default 5000).");
+
+static unsigned int debounce_encoder_us = 0;
+module_param(debounce_encoder_us, uint, 0644);
+MODULE_PARM_DESC(debounce_encoder_us, "Minimum time between two changes of an encoder "
+                "contact, in microseconds (0 - no debouncing, default 0).");
+
+static unsigned int debounce_selector_us = 5000;
+module_param(debounce_selector_us, uint, 0644);
+MODULE_PARM_DESC(debounce_selector_us, "Minimum time between two changes of a selector "
+                "contact, in microseconds (0 - no debouncing, default 5000).");
+
+static unsigned int encoder_accel_us[SAITEK_ACCEL_STEPS];
+static int encoder_accel_nus;
+module_param_array(encoder_accel_us, uint, &encoder_accel_nus, 0644);
+MODULE_PARM_DESC(encoder_accel_us, "Encoder acceleration: detent intervals, "
+                "in microseconds, below which encoder_accel_mult applies (up to 4).");
+
+static unsigned int encoder_accel_mult[SAITEK_ACCEL_STEPS];
+static int encoder_accel_nmult;
+module_param_array(encoder_accel_mult, uint, &encoder_accel_nmult, 0644);
+MODULE_PARM_DESC(encoder_accel_mult, "Encoder acceleration: detent multiplier for "
+                "the corresponding encoder_accel_us interval (default none - no acceleration).");
+
+static void saitek_chardev_release_kref(struct kref *kref)
+{
+        struct proflight_chardev *chardev;
+
+        chardev = container_of(kref, struct proflight_chardev, kref);
+        free_page((unsigned long)chardev->state); // mappings hold their own reference
+        ida_free(&saitek_proflight_ida, chardev->id);
+        kfree(chardev);
+}
+
+static int saitek_chardev_open(struct inode *inode, struct file *file)
+{
+        struct proflight_chardev *chardev;
+        struct proflight_client *client;
+        unsigned long flags;
+        int res;
+
+        // misc_open() holds misc_mtx here, so misc_deregister() cannot race us
+        chardev = container_of(file->private_data, struct proflight_chardev, miscdev);
+        client = kzalloc(sizeof(struct proflight_client), GFP_KERNEL);
+        if (!client)
+                return -ENOMEM;
+        res = kfifo_alloc(&client->events,
+                        roundup_pow_of_two(clamp_t(unsigned int, READ_ONCE(queue_depth),
+                                        SAITEK_MIN_QUEUE_DEPTH, SAITEK_MAX_QUEUE_DEPTH)),
+                        GFP_KERNEL);
+        if (res) {
+                kfree(client);
+                return res;
+        }
+        mutex_init(&client->read_mutex);
+        client->chardev = chardev;
+        kref_get(&chardev->kref);
+
+        spin_lock_irqsave(&chardev->lock, flags);
+        list_add_tail_rcu(&client->node, &chardev->clients);
+        spin_unlock_irqrestore(&chardev->lock, flags);
+
+        file->private_data = client;
+
+        return stream_open(inode, file);
+}
+
+static int saitek_chardev_release(struct inode *inode, struct file *file)
+{
+        struct proflight_client *client = file->private_data;
+        struct proflight_chardev *chardev = client->chardev;
+        unsigned long flags;
+
+        spin_lock_irqsave(&chardev->lock, flags);
+        list_del_rcu(&client->node);
+        spin_unlock_irqrestore(&chardev->lock, flags);
+        synchronize_rcu(); // the raw event handler may still be filling the queue
+
+        kfifo_free(&client->events);
+        mutex_destroy(&client->read_mutex);
+        kfree(client);
+        kref_put(&chardev->kref, saitek_chardev_release_kref);
+
+        return 0;
+}
+
+static int saitek_chardev_readable(struct proflight_client *client)
+{
+        return !kfifo_is_empty(&client->events) || READ_ONCE(client->chardev->disconnected);
+}
+
+static ssize_t saitek_chardev_read(struct file *file, char __user *buf,
+                size_t count, loff_t *ppos)
+{
+        struct proflight_client *client = file->private_data;
+        struct proflight_chardev *chardev = client->chardev;
+        unsigned int copied;
+        int res;
+
+        if (count < sizeof(struct proflight_event))
+                return -EINVAL;
+        count -= count % sizeof(struct proflight_event);
+
+        if (mutex_lock_interruptible(&client->read_mutex))
+                return -ERESTARTSYS;
+        while (kfifo_is_empty(&client->events)) {
+                if (READ_ONCE(chardev->disconnected)) {
+                        res = -ENODEV;
+                        goto exit;
+                }
+                if (file->f_flags & O_NONBLOCK) {
+                        res = -EAGAIN;
+                        goto exit;
+                }
+                res = wait_event_interruptible(chardev->wait, saitek_chardev_readable(client));
+                if (res)
+                        goto exit;
+        }
+        res = kfifo_to_user(&client->events, buf, count, &copied);
+exit:
+        mutex_unlock(&client->read_mutex);
+
+        return res ? res : copied;
+}
+
+static __poll_t saitek_chardev_poll(struct file *file, poll_table *wait)
+{
+        struct proflight_client *client = file->private_data;
+        struct proflight_chardev *chardev = client->chardev;
+        __poll_t mask = 0;
+
+        poll_wait(file, &chardev->wait, wait);
+        if (!kfifo_is_empty(&client->events))
+                mask |= EPOLLIN | EPOLLRDNORM;
+        if (READ_ONCE(chardev->disconnected))
+                mask |= EPOLLHUP | EPOLLERR;
+
+        return mask;
+}
+
+static int saitek_chardev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+        struct proflight_client *client = file->private_data;
+
+        if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE)
+                return -EINVAL;
+        if (vma->vm_flags & VM_WRITE)
+                return -EPERM;
+        vm_flags_clear(vma, VM_MAYWRITE);
+        vm_flags_set(vma, VM_DONTEXPAND | VM_DONTDUMP);
+
+        return vm_insert_page(vma, vma->vm_start, virt_to_page(client->chardev->state));
+}
+
+static const struct file_operations saitek_chardev_fops = {
+        .owner = THIS_MODULE,
+        .open = saitek_chardev_open,
+        .release = saitek_chardev_release,
+        .read = saitek_chardev_read,
+        .poll = saitek_chardev_poll,
+        .mmap = saitek_chardev_mmap,
+        .llseek = noop_llseek,
+};
+
+static int saitek_proflight_chardev_create(struct proflight *driver_data)
+{
+        struct proflight_chardev *chardev;
+        int res;
+
+        chardev = kzalloc(sizeof(struct proflight_chardev), GFP_KERNEL);
+        if (!chardev) {
+                hid_err(driver_data->hdev, "No memory for Saitek ProFlight character device.\n");
+                return -ENOMEM;
+        }
+        chardev->state = (struct proflight_state *)get_zeroed_page(GFP_KERNEL);
+        if (!chardev->state) {
+                hid_err(driver_data->hdev, "No memory for Saitek ProFlight state page.\n");
+                kfree(chardev);
+                return -ENOMEM;
+        }
+        chardev->state->version = PROFLIGHT_STATE_VERSION;
+        chardev->state->product_id = driver_data->product_id;
+        chardev->state->mode = driver_data->mode;
+        chardev->id = ida_alloc(&saitek_proflight_ida, GFP_KERNEL);
+        if (chardev->id < 0) {
+                res = chardev->id;
+                free_page((unsigned long)chardev->state);
+                kfree(chardev);
+                return res;
+        }
+        kref_init(&chardev->kref);
+        spin_lock_init(&chardev->lock);
+        INIT_LIST_HEAD(&chardev->clients);
+        init_waitqueue_head(&chardev->wait);
+        snprintf(chardev->name, sizeof(chardev->name), "proflight%d", chardev->id);
+        chardev->miscdev.minor = MISC_DYNAMIC_MINOR;
+        chardev->miscdev.name = chardev->name;
+        chardev->miscdev.fops = &saitek_chardev_fops;
+        chardev->miscdev.parent = &driver_data->hdev->dev;
+
+        res = misc_register(&chardev->miscdev);
+        if (res) {
+                hid_err(driver_data->hdev, "Cannot register %s (err %i).\n", chardev->name, res);
+                kref_put(&chardev->kref, saitek_chardev_release_kref);
+                return res;
+        }
+        driver_data->chardev = chardev;
+
+        return 0;
+}
+
+/*
+ * Must be called once input reports no longer arrive (after hid_hw_stop()).
+ * Open files keep the character device alive, but only see -ENODEV / EPOLLHUP.
+ */
+static void saitek_proflight_chardev_destroy(struct proflight *driver_data)
+{
+        struct proflight_chardev *chardev = driver_data->chardev;
+        unsigned long flags;
+
+        if (!chardev)
+                return;
+        driver_data->chardev = NULL;
+        misc_deregister(&chardev->miscdev);
+        spin_lock_irqsave(&chardev->lock, flags);
+        WRITE_ONCE(chardev->disconnected, 1);
+        spin_unlock_irqrestore(&chardev->lock, flags);
+        wake_up_interruptible(&chardev->wait);
+        kref_put(&chardev->kref, saitek_chardev_release_kref);
+}
+
+/*
+ * Mapping of the panel controls to the input subsystem: buttons and switches
+ * become BTN_TRIGGER_HAPPY1 + code, selectors ABS_X/ABS_Y and encoders the
+ * relative axes below (no REL_X/REL_Y/REL_WHEEL, not to look like a mouse).
+ */
+struct saitek_input_encoder {
+        __u16 code;
+        unsigned int rel;
+};
+
+struct saitek_input_map {
+        const __u16 *keys;
+        int nkeys;
+        const struct saitek_input_encoder *encoders;
+        int nencoders;
+        int nselectors;
+};
+
+static const __u16 saitek_radiopanel_keys[] = {
+        PROFLIGHT_RP_ACTSTBY0, PROFLIGHT_RP_ACTSTBY1,
+};
+
+static const struct saitek_input_encoder saitek_radiopanel_encoders[] = {
+        { PROFLIGHT_RP_INNERKNOB0, REL_RX },
+        { PROFLIGHT_RP_OUTERKNOB0, REL_RY },
+        { PROFLIGHT_RP_INNERKNOB1, REL_RZ },
+        { PROFLIGHT_RP_OUTERKNOB1, REL_MISC },
+};
+
+static const __u16 saitek_multipanel_keys[] = {
+        PROFLIGHT_MP_AP, PROFLIGHT_MP_HDG, PROFLIGHT_MP_NAV, PROFLIGHT_MP_IAS,
+        PROFLIGHT_MP_ALT, PROFLIGHT_MP_VS, PROFLIGHT_MP_APR, PROFLIGHT_MP_REV,
+        PROFLIGHT_MP_AUTO_THROTTLE,
+};
+
+static const struct saitek_input_encoder saitek_multipanel_encoders[] = {
+        { PROFLIGHT_MP_KNOB, REL_DIAL },
+        { PROFLIGHT_MP_FLAPS, REL_RX },
+        { PROFLIGHT_MP_PITCH_TRIM, REL_RY },
+};
+
+static const __u16 saitek_switchpanel_keys[] = {
+        PROFLIGHT_SP_MASTER_BAT, PROFLIGHT_SP_MASTER_ALT, PROFLIGHT_SP_AVIONICS,
+        PROFLIGHT_SP_FUEL_PUMP, PROFLIGHT_SP_DE_ICE, PROFLIGHT_SP_PITOT_HEAT,
+        PROFLIGHT_SP_COWL, PROFLIGHT_SP_PANEL, PROFLIGHT_SP_BEACON,
+        PROFLIGHT_SP_NAV, PROFLIGHT_SP_STROBE, PROFLIGHT_SP_TAXI,
+        PROFLIGHT_SP_LANDING, PROFLIGHT_SP_GEAR_UP, PROFLIGHT_SP_GEAR_DOWN,
+};
+
+static const struct saitek_input_map saitek_radiopanel_input_map = {
+        .keys = saitek_radiopanel_keys,
+        .nkeys = ARRAY_SIZE(saitek_radiopanel_keys),
+        .encoders = saitek_radiopanel_encoders,
+        .nencoders = ARRAY_SIZE(saitek_radiopanel_encoders),
+        .nselectors = 2,
+};
+
+static const struct saitek_input_map saitek_multipanel_input_map = {
+        .keys = saitek_multipanel_keys,
+        .nkeys = ARRAY_SIZE(saitek_multipanel_keys),
+        .encoders = saitek_multipanel_encoders,
+        .nencoders = ARRAY_SIZE(saitek_multipanel_encoders),
+        .nselectors = 1,
+};
+
+static const struct saitek_input_map saitek_switchpanel_input_map = {
+        .keys = saitek_switchpanel_keys,
+        .nkeys = ARRAY_SIZE(saitek_switchpanel_keys),
+        .nselectors = 1,
+};
+
+static const struct saitek_input_map *saitek_proflight_input_map(__u32 product_id)
+{
+        switch (product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                return &saitek_radiopanel_input_map;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                return &saitek_multipanel_input_map;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                return &saitek_switchpanel_input_map;
+        }
+
+        return NULL;
+}
+
+static int saitek_proflight_input_create(struct proflight *driver_data)
+{
+        const struct saitek_input_map *map;
+        struct hid_device *hdev = driver_data->hdev;
+        struct input_dev *input;
+        int i, res;
+
+        map = saitek_proflight_input_map(driver_data->product_id);
+        if (!map)
+                return -ENXIO;
+
+        input = devm_input_allocate_device(&hdev->dev);
+        if (!input) {
+                hid_err(hdev, "No memory for Saitek ProFlight input device.\n");
+                return -ENOMEM;
+        }
+        input->name = hdev->name;
+        input->phys = hdev->phys;
+        input->uniq = hdev->uniq;
+        input->id.bustype = hdev->bus;
+        input->id.vendor = hdev->vendor;
+        input->id.product = hdev->product;
+        input->id.version = hdev->version;
+
+        for (i = 0; i < map->nkeys; i++)
+                input_set_capability(input, EV_KEY, BTN_TRIGGER_HAPPY1 + map->keys[i]);
+        for (i = 0; i < map->nencoders; i++)
+                input_set_capability(input, EV_REL, map->encoders[i].rel);
+        for (i = 0; i < map->nselectors; i++)
+                input_set_abs_params(input, ABS_X + i, 0, 7, 0, 0);
+
+        res = input_register_device(input);
+        if (res) {
+                hid_err(hdev, "Cannot register Saitek ProFlight input device (err %i).\n", res);
+                return res;
+        }
+        driver_data->input = input;
+
+        return 0;
+}
+
+static void saitek_proflight_input_report(struct proflight *driver_data,
+                const struct proflight_event *event)
+{
+        const struct saitek_input_map *map;
+        int i;
+
+        switch (event->type) {
+        case PROFLIGHT_EV_KEY:
+                input_report_key(driver_data->input, BTN_TRIGGER_HAPPY1 + event->code, event->value);
+                break;
+        case PROFLIGHT_EV_REL:
+                map = saitek_proflight_input_map(driver_data->product_id);
+                for (i = 0; i < map->nencoders; i++)
+                        if (map->encoders[i].code == event->code)
+                                input_report_rel(driver_data->input, map->encoders[i].rel, event->value);
+                break;
+        case PROFLIGHT_EV_SEL:
+                input_report_abs(driver_data->input, ABS_X + event->code, event->value);
+                break;
+        case PROFLIGHT_EV_SYN:
+                input_sync(driver_data->input);
+                break;
+        }
+}
+
+/*
+ * LED class devices: the Multi Panel lights, and the Switch Panel gear
+ * lights as red/green multicolor LEDs. Setting one changes the shadow and
+ * goes through the output work like any other update, so LED triggers (timer,
+ * oneshot, heartbeat...) can drive the lights without userspace.
+ */
+struct saitek_led {
+        struct led_classdev_mc mc; // only mc.led_cdev on the Multi Panel
+        struct mc_subled subled[2]; // red, green
+        struct proflight *parent;
+        __u8 light; // PROFLIGHT_MULTIPANEL_LIGHT_*, PROFLIGHT_SWITCHPANEL_LIGHT_*_GREEN
+};
+
+struct saitek_led_info {
+        const char *name;
+        __u8 light;
+};
+
+static const struct saitek_led_info saitek_multipanel_leds[] = {
+        { "ap",  PROFLIGHT_MULTIPANEL_LIGHT_AP },
+        { "hdg", PROFLIGHT_MULTIPANEL_LIGHT_HDG },
+        { "nav", PROFLIGHT_MULTIPANEL_LIGHT_NAV },
+        { "ias", PROFLIGHT_MULTIPANEL_LIGHT_IAS },
+        { "alt", PROFLIGHT_MULTIPANEL_LIGHT_ALT },
+        { "vs",  PROFLIGHT_MULTIPANEL_LIGHT_VS },
+        { "apr", PROFLIGHT_MULTIPANEL_LIGHT_APR },
+        { "rev", PROFLIGHT_MULTIPANEL_LIGHT_REV },
+};
+
+static const struct saitek_led_info saitek_switchpanel_leds[] = {
+        { "gear-n", PROFLIGHT_SWITCHPANEL_LIGHT_N_GREEN },
+        { "gear-l", PROFLIGHT_SWITCHPANEL_LIGHT_L_GREEN },
+        { "gear-r", PROFLIGHT_SWITCHPANEL_LIGHT_R_GREEN },
+};
+
+static void saitek_led_output(struct proflight *driver_data)
+{
+        if (!READ_ONCE(driver_data->initialized))
+                return; // not started yet or being removed
+        saitek_proflight_publish_frame(driver_data);
+        saitek_proflight_schedule_output(driver_data);
+}
+
+static void saitek_multipanel_led_set(struct led_classdev *cdev, enum led_brightness brightness)
+{
+        struct saitek_led *led = container_of(cdev, struct saitek_led, mc.led_cdev);
+        struct proflight_multipanel *multipanel = led->parent->data.multipanel;
+        unsigned int on = (brightness != LED_OFF);
+        unsigned long flags;
+
+        SAITEK_OUTPUT_LOCK(&led->parent->output_lock, flags);
+        switch (led->light) {
+        case PROFLIGHT_MULTIPANEL_LIGHT_AP:  multipanel->led_ap  = on; break;
+        case PROFLIGHT_MULTIPANEL_LIGHT_HDG: multipanel->led_hdg = on; break;
+        case PROFLIGHT_MULTIPANEL_LIGHT_NAV: multipanel->led_nav = on; break;
+        case PROFLIGHT_MULTIPANEL_LIGHT_IAS: multipanel->led_ias = on; break;
+        case PROFLIGHT_MULTIPANEL_LIGHT_ALT: multipanel->led_alt = on; break;
+        case PROFLIGHT_MULTIPANEL_LIGHT_VS:  multipanel->led_vs  = on; break;
+        case PROFLIGHT_MULTIPANEL_LIGHT_APR: multipanel->led_apr = on; break;
+        case PROFLIGHT_MULTIPANEL_LIGHT_REV: multipanel->led_rev = on; break;
+        }
+        SAITEK_OUTPUT_UNLOCK(&led->parent->output_lock, flags);
+        saitek_led_output(led->parent);
+}
+
+static enum led_brightness saitek_multipanel_led_get(struct led_classdev *cdev)
+{
+        struct saitek_led *led = container_of(cdev, struct saitek_led, mc.led_cdev);
+        __u8 report[SAITEK_HID_BUF_LEN];
+        unsigned long flags;
+
+        SAITEK_OUTPUT_LOCK(&led->parent->output_lock, flags);
+        saitek_fill_multipanel_report(led->parent->data.multipanel, report);
+        SAITEK_OUTPUT_UNLOCK(&led->parent->output_lock, flags);
+
+        return (report[11] & led->light) ? LED_ON : LED_OFF;
+}
+
+static void saitek_switchpanel_led_set(struct led_classdev *cdev, enum led_brightness brightness)
+{
+        struct led_classdev_mc *mc = lcdev_to_mccdev(cdev);
+        struct saitek_led *led = container_of(mc, struct saitek_led, mc);
+        struct proflight_switchpanel *switchpanel = led->parent->data.switchpanel;
+        unsigned long flags;
+        int red, green;
+        char color;
+
+        led_mc_calc_color_components(mc, brightness);
+        red = led->subled[0].brightness;
+        green = led->subled[1].brightness;
+        color = (red && green) ? 'Y' : red ? 'R' : green ? 'G' : '\000';
+
+        SAITEK_OUTPUT_LOCK(&led->parent->output_lock, flags);
+        switch (led->light) {
+        case PROFLIGHT_SWITCHPANEL_LIGHT_N_GREEN: switchpanel->led_n = color; break;
+        case PROFLIGHT_SWITCHPANEL_LIGHT_L_GREEN: switchpanel->led_l = color; break;
+        case PROFLIGHT_SWITCHPANEL_LIGHT_R_GREEN: switchpanel->led_r = color; break;
+        }
+        SAITEK_OUTPUT_UNLOCK(&led->parent->output_lock, flags);
+        saitek_led_output(led->parent);
+}
+
+/*
+ * Unregisters the LED class devices before the chardev goes away: devm would
+ * only do it after remove() returns, while a trigger may still set one.
+ */
+static void saitek_proflight_leds_destroy(struct proflight *driver_data)
+{
+        struct hid_device *hdev = driver_data->hdev;
+        int i;
+
+        if (!IS_ENABLED(CONFIG_LEDS_CLASS))
+                return;
+        for (i = driver_data->nleds - 1; i >= 0; i--) {
+                if (driver_data->product_id == USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL)
+                        devm_led_classdev_multicolor_unregister(&hdev->dev,
+                                        &driver_data->leds[i].mc);
+                else
+                        devm_led_classdev_unregister(&hdev->dev,
+                                        &driver_data->leds[i].mc.led_cdev);
+        }
+        driver_data->nleds = 0;
+}
+
+/*
+ * Registers the LED class devices, if the kernel has the LED class (and
+ * multicolor LEDs for the Switch Panel); without them the lights are still
+ * driven through the sysfs attributes and the chardev.
+ */
+static int saitek_proflight_leds_create(struct proflight *driver_data)
+{
+        const struct saitek_led_info *info;
+        struct hid_device *hdev = driver_data->hdev;
+        struct led_classdev *cdev;
+        struct saitek_led *led;
+        int multicolor, nleds, i, res;
+
+        if (!IS_ENABLED(CONFIG_LEDS_CLASS))
+                return 0;
+        switch (driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                info = saitek_multipanel_leds;
+                nleds = ARRAY_SIZE(saitek_multipanel_leds);
+                multicolor = 0;
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                if (!IS_ENABLED(CONFIG_LEDS_CLASS_MULTICOLOR))
+                        return 0;
+                info = saitek_switchpanel_leds;
+                nleds = ARRAY_SIZE(saitek_switchpanel_leds);
+                multicolor = 1;
+                break;
+        default:
+                return 0;
+        }
+
+        driver_data->leds = devm_kcalloc(&hdev->dev, nleds,
+                        sizeof(struct saitek_led), GFP_KERNEL);
+        if (!driver_data->leds) {
+                hid_err(hdev, "No memory for Saitek ProFlight LEDs.\n");
+                return -ENOMEM;
+        }
+        for (i = 0; i < nleds; i++) {
+                led = &driver_data->leds[i];
+                led->parent = driver_data;
+                led->light = info[i].light;
+                cdev = &led->mc.led_cdev;
+                cdev->max_brightness = 1;
+                cdev->name = devm_kasprintf(&hdev->dev, GFP_KERNEL, "%s:%s:%s",
+                                dev_name(&hdev->dev), multicolor ? "multicolor" : "",
+                                info[i].name);
+                if (!cdev->name) {
+                        saitek_proflight_leds_destroy(driver_data);
+                        return -ENOMEM;
+                }
+                if (multicolor) {
+                        led->subled[0].color_index = LED_COLOR_ID_RED;
+                        led->subled[0].channel = 0;
+                        led->subled[1].color_index = LED_COLOR_ID_GREEN;
+                        led->subled[1].channel = 1;
+                        led->subled[1].intensity = 1; // green, as in gear down and locked
+                        led->mc.num_colors = 2;
+                        led->mc.subled_info = led->subled;
+                        cdev->brightness_set = saitek_switchpanel_led_set;
+                        res = devm_led_classdev_multicolor_register(&hdev->dev, &led->mc);
+                } else {
+                        cdev->brightness_set = saitek_multipanel_led_set;
+                        cdev->brightness_get = saitek_multipanel_led_get;
+                        res = devm_led_classdev_register(&hdev->dev, cdev);
+                }
+                if (res) {
+                        hid_err(hdev, "Cannot register Saitek ProFlight LED %s (err %i).\n",
+                                        cdev->name, res);
+                        saitek_proflight_leds_destroy(driver_data);
+                        return res;
+                }
+                driver_data->nleds++;
+        }
 
-        return ret_val;
+        return 0;
 }
 
-static DEVICE_ATTR(proflight,
-                S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH,
-                saitek_proflight_show, saitek_proflight_store);
+/*
+ * Driver data, panel data and the lock, allocated in one go. The DMA buffer
+ * stays separate: it must not share cache lines with data the CPU writes
+ * while a transfer is in flight.
+ */
+struct saitek_proflight_alloc {
+        struct proflight driver_data;
+        union {
+                struct proflight_radiopanel radiopanel;
+                struct proflight_multipanel multipanel;
+                struct proflight_switchpanel switchpanel;
+        } panel;
+        struct rw_semaphore lock;
+};
 
 static int saitek_proflight_alloc_panel_data(
                 struct hid_device *hdev, const struct hid_device_id *id,
                 struct proflight **driver_data_p)
 {
-        union proflight_panel_data panel_data;
+        struct saitek_proflight_alloc *alloc;
+        struct proflight *driver_data;
 
-        switch (id->product) {
-        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
-                panel_data.radiopanel = devm_kzalloc(&hdev->dev, sizeof(struct proflight_radiopanel), GFP_KERNEL);
-                if (!panel_data.radiopanel) {
-                        hid_err(hdev, "No memory for Saitek ProFlight Radio Panel data.\n");
-                        return -ENOMEM;
-                }
-                break;
-        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
-                panel_data.multipanel = devm_kzalloc(&hdev->dev, sizeof(struct proflight_multipanel), GFP_KERNEL);
-                if (!panel_data.multipanel) {
-                        hid_err(hdev, "No memory for Saitek ProFlight Multi Panel data.\n");
-                        return -ENOMEM;
-                }
-                break;
-        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
-                panel_data.switchpanel = devm_kzalloc(&hdev->dev, sizeof(struct proflight_switchpanel), GFP_KERNEL);
-                if (!panel_data.switchpanel) {
-                        hid_err(hdev, "No memory for Saitek ProFlight Switch Panel data.\n");
-                        return -ENOMEM;
-                }
-                break;
-        }
-        *driver_data_p = devm_kzalloc(&hdev->dev, sizeof(struct proflight), GFP_KERNEL);
-        if (!(*driver_data_p)) {
+        alloc = devm_kzalloc(&hdev->dev, sizeof(*alloc), GFP_KERNEL);
+        if (!alloc) {
                 hid_err(hdev, "No memory for Saitek ProFlight driver data.\n");
                 return -ENOMEM;
         }
+        driver_data = &alloc->driver_data;
+        driver_data->lock = &alloc->lock;
         switch (id->product) {
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
-                panel_data.radiopanel->parent = *driver_data_p;
+                driver_data->data.radiopanel = &alloc->panel.radiopanel;
+                driver_data->data.radiopanel->parent = driver_data;
                 break;
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
-                panel_data.multipanel->parent = *driver_data_p;
+                driver_data->data.multipanel = &alloc->panel.multipanel;
+                driver_data->data.multipanel->parent = driver_data;
                 break;
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
-                panel_data.switchpanel->parent = *driver_data_p;
+                driver_data->data.switchpanel = &alloc->panel.switchpanel;
+                driver_data->data.switchpanel->parent = driver_data;
                 break;
         }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
-        (*driver_data_p)->data = panel_data;
-#pragma GCC diagnostic pop
-
-        (*driver_data_p)->dmabuf = devm_kzalloc(&hdev->dev, SAITEK_HID_BUF_LEN, GFP_DMA | GFP_KERNEL);
-        if (!((*driver_data_p)->dmabuf)) {
+        driver_data->dmabuf = devm_kzalloc(&hdev->dev, SAITEK_HID_BUF_LEN, GFP_DMA | GFP_KERNEL);
+        if (!driver_data->dmabuf) {
                 hid_err(hdev, "No memory for Saitek ProFlight HID buffer.\n");
                 return -ENOMEM;
         }
+        *driver_data_p = driver_data;
 
         return 0;
 }
 
+/*
+ * Blanks the displays in the shadow; zeros would show as "00000" until the
+ * sim writes something.
+ */
+static void saitek_proflight_blank(struct proflight *driver_data)
+{
+        switch (driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                memset(driver_data->data.radiopanel->display0l, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+                memset(driver_data->data.radiopanel->display0r, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+                memset(driver_data->data.radiopanel->display1l, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+                memset(driver_data->data.radiopanel->display1r, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                memset(driver_data->data.multipanel->display0, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+                memset(driver_data->data.multipanel->display1, PROFLIGHT_PANEL_DIGIT_NULL, 5);
+                break;
+        }
+}
+
 static int saitek_proflight_hid_start(struct hid_device *hdev)
 {
         int res;
@@ -768,7 +3382,8 @@ static int saitek_proflight_hid_start(struct hid_device *hdev)
                 return res;
         }
 
-        res = hid_hw_start(hdev, HID_CONNECT_DEFAULT);
+        // the driver registers its own input device, see saitek_proflight_input_create()
+        res = hid_hw_start(hdev, HID_CONNECT_DEFAULT & ~HID_CONNECT_HIDINPUT);
         if (res) {
                 hid_err(hdev, "Initial HID hw start failed for Saitek ProFlight driver.\n");
                 return res;
@@ -777,9 +3392,73 @@ static int saitek_proflight_hid_start(struct hid_device *hdev)
         return 0;
 }
 
+static void saitek_proflight_debounce_work(struct work_struct *work);
+static int saitek_proflight_handle_report(struct proflight *driver_data, struct hid_device *hdev,
+                struct hid_report *report, u8 *data, int size);
+
+/*
+ * Asks the device for its input report and decodes it like one that arrived
+ * on its own, so that switches and selectors are known before anything gets
+ * moved. A device that does not answer is only reported; its state then
+ * comes with the first interrupt report, as before.
+ */
+static void saitek_proflight_read_state(struct proflight *driver_data)
+{
+        struct hid_device *hdev = driver_data->hdev;
+        struct hid_report *report;
+        unsigned long flags;
+        s64 reports;
+        __u8 *buf;
+        int res;
+
+        report = hdev->report_enum[HID_INPUT_REPORT].report_id_hash[0];
+        if (!report)
+                return;
+        buf = kzalloc(SAITEK_HID_BUF_LEN, GFP_KERNEL);
+        if (!buf)
+                return;
+        reports = atomic64_read(&driver_data->stats.reports);
+        // report ID 0 (unnumbered): the data follows the ID byte in buf
+        res = hid_hw_raw_request(hdev, 0, buf, PROFLIGHT_INPUT_REPORT_LEN + 1,
+                        HID_INPUT_REPORT, HID_REQ_GET_REPORT);
+        if (res < PROFLIGHT_INPUT_REPORT_LEN + 1) {
+                hid_warn(hdev, "Cannot read the initial Saitek ProFlight state (%d).\n", res);
+                kfree(buf);
+                return;
+        }
+        trace_saitek_raw_event(hdev, &buf[1], res - 1);
+        // raw_event counts a report before it takes the lock: compare under it
+        SAITEK_INPUT_WRITE_BEGIN(&driver_data->input_lock, flags);
+        if (atomic64_read(&driver_data->stats.reports) == reports) {
+                atomic64_inc(&driver_data->stats.reports);
+                driver_data->event_time_ns = ktime_get_ns();
+                saitek_proflight_handle_report(driver_data, hdev, report, &buf[1], res - 1);
+        }
+        // otherwise an interrupt report, at least as recent, got there first
+        SAITEK_INPUT_WRITE_END(&driver_data->input_lock, flags);
+        kfree(buf);
+}
+
+/*
+ * Second half of probe, run from a work item so that probe() itself does no
+ * device I/O and a cockpit full of panels comes up in parallel: sends the
+ * blanked displays and fetches the input state.
+ */
+static void saitek_proflight_bringup_work(struct work_struct *work)
+{
+        struct proflight *driver_data;
+
+        driver_data = container_of(work, struct proflight, bringup_work);
+        saitek_proflight_schedule_output(driver_data);
+        saitek_proflight_read_state(driver_data);
+        WRITE_ONCE(driver_data->stats.ready_ns,
+                        ktime_get_ns() - driver_data->stats.probe_start_ns);
+}
+
 static int saitek_proflight_probe(struct hid_device *hdev, const struct hid_device_id *id)
 {
         struct proflight *driver_data;
+        u64 start = ktime_get_ns();
         int res = 0;
 
         hid_info(hdev, "Saitek ProFlight driver probe.\n");
@@ -789,35 +3468,68 @@ static int saitek_proflight_probe(struct hid_device *hdev, const struct hid_devi
                 hid_err(hdev, "Failed to initialize panel data.\n");
                 goto exit;
         }
-        driver_data->lock = devm_kzalloc(&hdev->dev, sizeof(SAITEK_LOCK_SIZE), GFP_KERNEL);
-        if (!driver_data->lock) {
-                hid_err(hdev, "Failed to initialize semaphore.\n");
-                goto exit;
-        }
         SAITEK_INIT_LOCK(driver_data->lock);
-        SAITEK_LOCK_WRITE(driver_data->lock);
-        res = device_create_file(&hdev->dev, &dev_attr_proflight);
-        if (res) {
-                hid_err(hdev, "Failed to initialize device attribuutes.\n");
-                goto fail_dev;
-        }
+        SAITEK_INIT_INPUT_LOCK(&driver_data->input_lock);
+        SAITEK_INIT_OUTPUT_LOCK(&driver_data->output_lock);
+        INIT_WORK(&driver_data->output_work, saitek_proflight_output_work);
+        INIT_DELAYED_WORK(&driver_data->debounce_work, saitek_proflight_debounce_work);
+        INIT_WORK(&driver_data->bringup_work, saitek_proflight_bringup_work);
+        hrtimer_setup(&driver_data->anim_timer, saitek_proflight_anim_timer, CLOCK_MONOTONIC,
+                        HRTIMER_MODE_ABS);
+        driver_data->stats.probe_start_ns = start;
         driver_data->product_id = id->product;
         driver_data->hdev = hdev;
         driver_data->mode = 'R';
+        saitek_proflight_init_limits(driver_data);
+        saitek_proflight_blank(driver_data);
+        if (id->product == USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL)
+                saitek_autopilot_init(driver_data->data.multipanel);
+        if (id->product == USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL)
+                saitek_tuner_init(driver_data->data.radiopanel);
         hid_set_drvdata(hdev, driver_data);
 
+        res = saitek_proflight_input_create(driver_data);
+        if (res)
+                goto exit;
+
+        res = saitek_proflight_chardev_create(driver_data);
+        if (res)
+                goto exit;
+
+        res = saitek_proflight_leds_create(driver_data);
+        if (res)
+                goto fail_chardev;
+
         res = saitek_proflight_hid_start(hdev);
         if (res)
-                goto fail_dev;
+                goto fail_leds;
 
+        // sysfs callbacks check initialized, so the lock is only needed to set it
+        res = device_add_group(&hdev->dev, &saitek_proflight_attr_group);
+        if (res) {
+                hid_err(hdev, "Failed to initialize device attribuutes.\n");
+                goto fail_hw;
+        }
+        saitek_proflight_debugfs_create(driver_data);
+        SAITEK_LOCK_WRITE(driver_data->lock);
         driver_data->initialized = 1;
+        SAITEK_UNLOCK_WRITE(driver_data->lock);
 
-        goto exit_sem;
+        queue_work(system_unbound_wq, &driver_data->bringup_work);
+        WRITE_ONCE(driver_data->stats.probe_ns, ktime_get_ns() - start);
 
-fail_dev:
-        device_remove_file(&hdev->dev, &dev_attr_proflight);
-exit_sem:
-        SAITEK_UNLOCK_WRITE(driver_data->lock);
+        return 0;
+
+fail_hw:
+        // input reports may already have queued output
+        disable_work_sync(&driver_data->output_work);
+        hrtimer_cancel(&driver_data->anim_timer);
+        hid_hw_stop(hdev);
+fail_leds:
+        saitek_proflight_leds_destroy(driver_data);
+fail_chardev:
+        cancel_delayed_work_sync(&driver_data->debounce_work);
+        saitek_proflight_chardev_destroy(driver_data);
 exit:
         return res;
 }
@@ -825,8 +3537,9 @@ exit:
 void saitek_proflight_remove(struct hid_device *hdev)
 {
         struct proflight *driver_data;
-    
-        printk("Saitek ProFlight driver remove...\n");
+        int initialized;
+
+        hid_info(hdev, "Saitek ProFlight driver remove.\n");
 
         driver_data = hid_get_drvdata(hdev);
         if (!driver_data) {
@@ -834,12 +3547,477 @@ void saitek_proflight_remove(struct hid_device *hdev)
                 return;
         }
         SAITEK_LOCK_WRITE(driver_data->lock);
-        if (driver_data->initialized) {
+        initialized = driver_data->initialized;
+        driver_data->initialized = 0; // no more output gets scheduled from now on
+        SAITEK_UNLOCK_WRITE(driver_data->lock);
+        if (initialized) {
+                // sysfs removal waits for running callbacks, so not under the lock
+                device_remove_group(&hdev->dev, &saitek_proflight_attr_group);
+                debugfs_remove_recursive(driver_data->debugfs);
+                // a trigger may be setting one right now, unregistering waits for it
+                saitek_proflight_leds_destroy(driver_data);
+                cancel_work_sync(&driver_data->bringup_work);
+                // input reports may still queue output (autopilot model) until hid_hw_stop()
+                disable_work_sync(&driver_data->output_work);
+                hrtimer_cancel(&driver_data->anim_timer);
                 hid_hw_stop(hdev);
-                device_remove_file(&hdev->dev, &dev_attr_proflight);
-                driver_data->initialized = 0;
+                cancel_delayed_work_sync(&driver_data->debounce_work);
+                saitek_proflight_chardev_destroy(driver_data);
         }
-        SAITEK_UNLOCK_WRITE(driver_data->lock);
+}
+
+/*
+ * Queues an event decoded from the report being processed. Called with the
+ * input lock held; the batch is handed to the readers by
+ * saitek_proflight_flush_events().
+ */
+static void saitek_proflight_emit(struct proflight *driver_data,
+                __u16 type, __u16 code, __s32 value)
+{
+        struct proflight_event *event;
+
+        if (driver_data->nevents >= SAITEK_MAX_REPORT_EVENTS - 1)
+                return; // keep room for PROFLIGHT_EV_SYN
+        event = &driver_data->events[driver_data->nevents++];
+        event->time_ns = driver_data->event_time_ns;
+        event->type = type;
+        event->code = code;
+        event->value = value;
+}
+
+static void saitek_state_apply_event(struct proflight_state *state,
+                const struct proflight_event *event)
+{
+        switch (event->type) {
+        case PROFLIGHT_EV_KEY:
+                if (event->code >= PROFLIGHT_MAX_CODES)
+                        break;
+                if (event->value) {
+                        state->keys |= 1u << event->code;
+                        state->presses[event->code]++;
+                } else {
+                        state->keys &= ~(1u << event->code);
+                }
+                break;
+        case PROFLIGHT_EV_REL:
+                if (event->code < PROFLIGHT_MAX_CODES)
+                        state->encoders[event->code] += event->value;
+                break;
+        case PROFLIGHT_EV_SEL:
+                if (event->code < ARRAY_SIZE(state->selectors))
+                        state->selectors[event->code] = event->value;
+                break;
+        }
+}
+
+/*
+ * Appends the batch to the client's queue, or drops it as a whole when it
+ * does not fit. The loss is reported in front of the next batch that fits,
+ * as a PROFLIGHT_SYN_DROPPED event carrying the number of events lost.
+ */
+static void saitek_client_queue(struct proflight *driver_data,
+                struct proflight_client *client, int nevents)
+{
+        struct proflight_event dropped;
+
+        if (kfifo_avail(&client->events) < nevents + (client->dropped ? 1 : 0)) {
+                client->dropped += nevents;
+                atomic_add(nevents, &driver_data->events_dropped);
+                return;
+        }
+        if (client->dropped) {
+                dropped.time_ns = driver_data->event_time_ns;
+                dropped.type = PROFLIGHT_EV_SYN;
+                dropped.code = PROFLIGHT_SYN_DROPPED;
+                dropped.value = client->dropped;
+                kfifo_put(&client->events, dropped);
+                client->dropped = 0;
+        }
+        kfifo_in(&client->events, driver_data->events, nevents);
+}
+
+/*
+ * Terminates the batch of events decoded from one report, reports it to the
+ * input subsystem, applies it to the state page and copies it to the queue of
+ * every open file. A batch that does not fit into a queue is
+ * dropped as a whole, so that readers never see half a report.
+ */
+static void saitek_proflight_flush_events(struct proflight *driver_data)
+{
+        struct proflight_chardev *chardev = driver_data->chardev;
+        struct proflight_client *client;
+        int nevents = driver_data->nevents;
+        int i;
+
+        driver_data->nevents = 0;
+        if (!nevents)
+                return;
+        atomic64_add(nevents, &driver_data->stats.events);
+        driver_data->events[nevents].time_ns = driver_data->event_time_ns;
+        driver_data->events[nevents].type = PROFLIGHT_EV_SYN;
+        driver_data->events[nevents].code = PROFLIGHT_SYN_REPORT;
+        driver_data->events[nevents].value = 0;
+        nevents++;
+
+        if (driver_data->input)
+                for (i = 0; i < nevents; i++)
+                        saitek_proflight_input_report(driver_data, &driver_data->events[i]);
+        if (!chardev)
+                return;
+
+        spin_lock(&chardev->lock);
+        saitek_state_write_begin(chardev->state);
+        chardev->state->time_ns = driver_data->event_time_ns;
+        for (i = 0; i < nevents; i++)
+                saitek_state_apply_event(chardev->state, &driver_data->events[i]);
+        saitek_state_write_end(chardev->state);
+        spin_unlock(&chardev->lock);
+
+        rcu_read_lock();
+        list_for_each_entry_rcu(client, &chardev->clients, node)
+                saitek_client_queue(driver_data, client, nevents);
+        rcu_read_unlock();
+        wake_up_interruptible(&chardev->wait);
+}
+
+static __u32 saitek_report_bits(const u8 *data)
+{
+        return data[0] | (data[1] << 8) | (data[2] << 16);
+}
+
+/*
+ * Detent multiplier for an encoder turned interval ns after its previous
+ * detent in the same direction: the largest multiplier whose interval is
+ * longer than that.
+ */
+static int saitek_encoder_accel(u64 interval)
+{
+        int steps, mult = 1, i;
+
+        steps = min(READ_ONCE(encoder_accel_nus), READ_ONCE(encoder_accel_nmult));
+        for (i = 0; i < steps && i < SAITEK_ACCEL_STEPS; i++)
+                if (interval < (u64)READ_ONCE(encoder_accel_us[i]) * NSEC_PER_USEC)
+                        mult = max_t(int, mult, READ_ONCE(encoder_accel_mult[i]));
+
+        return mult;
+}
+
+static u64 saitek_debounce_ns(int kind)
+{
+        switch (kind) {
+        case SAITEK_CTL_KEY:
+        case SAITEK_CTL_COUNTED_KEY:
+                return (u64)READ_ONCE(debounce_key_us) * NSEC_PER_USEC;
+        case SAITEK_CTL_ENC_UP:
+        case SAITEK_CTL_ENC_DOWN:
+                return (u64)READ_ONCE(debounce_encoder_us) * NSEC_PER_USEC;
+        case SAITEK_CTL_SEL:
+                return (u64)READ_ONCE(debounce_selector_us) * NSEC_PER_USEC;
+        }
+
+        return 0;
+}
+
+/*
+ * Applies the bits that changed since the previous report to the panel data,
+ * emitting an event for every change. Called with the input lock held.
+ *
+ * Debouncing is leading edge: a change is taken at once, unless the same bit
+ * already changed less than its window ago, in which case it is held back and
+ * counted as a glitch. Whatever is still held back once the contacts settle
+ * is re-evaluated by the debounce work when the window is over, so that a real
+ * change right after a bounce is not lost. A selector caught between two
+ * positions keeps the previous one.
+ */
+static void saitek_proflight_decode(struct proflight *driver_data, void *panel,
+                const struct saitek_decoder *decoder, __u32 *bits, __u32 report)
+{
+        const struct saitek_control *ctl;
+        const struct saitek_selector *sel;
+        __u32 changed, fresh, accepted, selectors = 0;
+        u64 now = driver_data->event_time_ns;
+        u64 window, next = U64_MAX;
+        atomic_t *counter;
+        int bit, on, dir, delta, mode, i;
+        int *modep;
+
+        fresh = report ^ driver_data->raw; // changes the device reported just now
+        WRITE_ONCE(driver_data->raw, report);
+        accepted = *bits;
+        changed = report ^ accepted;
+        while (changed) {
+                bit = __ffs(changed);
+                changed &= changed - 1;
+                ctl = &decoder->controls[bit];
+                window = saitek_debounce_ns(ctl->kind);
+                if (now - driver_data->changed_ns[bit] < window) {
+                        if (fresh & (1u << bit))
+                                atomic64_inc(&driver_data->stats.glitches);
+                        next = min(next, driver_data->changed_ns[bit] + window - now);
+                        continue;
+                }
+                driver_data->changed_ns[bit] = now;
+                accepted ^= 1u << bit;
+                on = (report >> bit) & 1;
+                switch (ctl->kind) {
+                case SAITEK_CTL_KEY:
+                        saitek_proflight_emit(driver_data, PROFLIGHT_EV_KEY, ctl->code, on);
+                        break;
+                case SAITEK_CTL_COUNTED_KEY:
+                        counter = (atomic_t *)((char *)panel + ctl->counter);
+                        if (on && !saitek_counter_add(counter, 1, &driver_data->limits[ctl->code])) {
+                                atomic_inc(&driver_data->saturated[ctl->code]);
+                                atomic64_inc(&driver_data->stats.clamps);
+                        }
+                        saitek_proflight_emit(driver_data, PROFLIGHT_EV_KEY, ctl->code, on);
+                        break;
+                case SAITEK_CTL_ENC_UP:
+                case SAITEK_CTL_ENC_DOWN:
+                        if (!on)
+                                break; // a detent is counted when its bit gets set
+                        counter = (atomic_t *)((char *)panel + ctl->counter);
+                        dir = (ctl->kind == SAITEK_CTL_ENC_UP) ? 1 : -1;
+                        if (driver_data->detent_dir[ctl->code] == dir)
+                                delta = dir * saitek_encoder_accel(now - driver_data->detent_ns[ctl->code]);
+                        else
+                                delta = dir; // a change of direction starts slow
+                        driver_data->detent_ns[ctl->code] = now;
+                        driver_data->detent_dir[ctl->code] = dir;
+                        if (!saitek_counter_add(counter, delta, &driver_data->limits[ctl->code])) {
+                                atomic_inc(&driver_data->saturated[ctl->code]);
+                                atomic64_inc(&driver_data->stats.clamps);
+                        }
+                        saitek_proflight_emit(driver_data, PROFLIGHT_EV_REL, ctl->code, delta);
+                        break;
+                case SAITEK_CTL_SEL:
+                        selectors |= 1u << ctl->code;
+                        break;
+                }
+        }
+        *bits = accepted;
+
+        for (i = 0; i < decoder->nselectors; i++) {
+                if (!(selectors & (1u << i)))
+                        continue;
+                sel = &decoder->selectors[i];
+                if (!(accepted & sel->mask)) {
+                        atomic64_inc(&driver_data->stats.glitches); // between two positions
+                        continue;
+                }
+                if (sel->msb_first)
+                        mode = decoder->controls[__fls(accepted & sel->mask)].value;
+                else
+                        mode = decoder->controls[__ffs(accepted & sel->mask)].value;
+                modep = (int *)((char *)panel + sel->mode);
+                if (*modep != mode) {
+                        *modep = mode;
+                        saitek_proflight_emit(driver_data, PROFLIGHT_EV_SEL, i, mode);
+                }
+        }
+
+        if (next != U64_MAX)
+                queue_delayed_work(system_highpri_wq, &driver_data->debounce_work,
+                                nsecs_to_jiffies(next) + 1);
+}
+
+/*
+ * Shows the page of the position a selector has just moved to, if there is
+ * one, without waiting for userspace to catch up. Called with the input lock
+ * held.
+ */
+static void saitek_proflight_flip_pages(struct proflight *driver_data)
+{
+        struct proflight_radiopanel *radiopanel;
+        unsigned long flags;
+        int mode = -1, mode1 = -1;
+        int flipped = 0;
+        int i;
+
+        for (i = 0; i < driver_data->nevents; i++) {
+                if (driver_data->events[i].type != PROFLIGHT_EV_SEL
+                                || driver_data->events[i].value >= PROFLIGHT_PAGES)
+                        continue;
+                if (driver_data->events[i].code == PROFLIGHT_SEL_0)
+                        mode = driver_data->events[i].value;
+                else
+                        mode1 = driver_data->events[i].value;
+        }
+        if (mode < 0 && mode1 < 0)
+                return;
+
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        if (driver_data->product_id == USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL) {
+                radiopanel = driver_data->data.radiopanel;
+                if (mode >= 0 && test_bit(mode, &driver_data->pages_valid)) {
+                        memcpy(radiopanel->display0l, &driver_data->pages[mode][0], 5);
+                        memcpy(radiopanel->display0r, &driver_data->pages[mode][5], 5);
+                        flipped = 1;
+                }
+                if (mode1 >= 0 && test_bit(mode1, &driver_data->pages_valid)) {
+                        memcpy(radiopanel->display1l, &driver_data->pages[mode1][10], 5);
+                        memcpy(radiopanel->display1r, &driver_data->pages[mode1][15], 5);
+                        flipped = 1;
+                }
+        } else if (mode >= 0 && test_bit(mode, &driver_data->pages_valid)) {
+                saitek_proflight_load_frame(driver_data, driver_data->pages[mode]);
+                flipped = 1;
+        }
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        if (!flipped)
+                return;
+
+        saitek_proflight_publish_frame(driver_data);
+        saitek_proflight_schedule_output(driver_data);
+}
+
+/*
+ * Applies the output rules matching the batch of events just decoded to the
+ * display/LED shadow, in the order of the table. Called with the input lock
+ * held.
+ */
+static void saitek_proflight_rules(struct proflight *driver_data)
+{
+        const struct proflight_event *event;
+        const struct proflight_rule *rule;
+        __u8 report[SAITEK_HID_BUF_LEN];
+        __u8 *frame = &report[1];
+        unsigned long flags = 0;
+        int matched = 0;
+        int i, j;
+
+        if (!driver_data->nrules)
+                return;
+        for (i = 0; i < driver_data->nevents; i++) {
+                event = &driver_data->events[i];
+                for (j = 0; j < driver_data->nrules; j++) {
+                        rule = &driver_data->rules[j];
+                        if (rule->type != event->type || rule->code != event->code
+                                        || (!(rule->flags & PROFLIGHT_RULE_ANY_VALUE)
+                                                && rule->value != event->value))
+                                continue;
+                        if (!matched++) {
+                                SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+                                saitek_proflight_fill_report(driver_data, report);
+                        }
+                        if (rule->action == PROFLIGHT_RULE_TOGGLE)
+                                frame[rule->offset] ^= rule->mask;
+                        else
+                                frame[rule->offset] = (frame[rule->offset] & ~rule->mask)
+                                                | (rule->bits & rule->mask);
+                }
+        }
+        if (!matched)
+                return;
+
+        saitek_proflight_load_frame(driver_data, frame);
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        saitek_proflight_publish_frame(driver_data);
+        saitek_proflight_schedule_output(driver_data);
+}
+
+/*
+ * Feeds the batch of events just decoded to the Multi Panel autopilot model:
+ * knob detents step the value of the selected position, and the displays are
+ * re-rendered and sent whenever a value or the position changed. Called with
+ * the input lock held.
+ */
+static void saitek_proflight_autopilot(struct proflight *driver_data)
+{
+        struct proflight_multipanel *multipanel = driver_data->data.multipanel;
+        const struct proflight_event *event;
+        struct saitek_autopilot_value *ap;
+        unsigned long flags;
+        int changed = 0;
+        int i;
+
+        if (driver_data->product_id != USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL
+                        || !multipanel->autopilot)
+                return;
+        for (i = 0; i < driver_data->nevents; i++) {
+                event = &driver_data->events[i];
+                if (event->type == PROFLIGHT_EV_SEL) {
+                        changed = 1;
+                } else if (event->type == PROFLIGHT_EV_REL && event->code == PROFLIGHT_MP_KNOB
+                                && multipanel->mode >= PROFLIGHT_MULTIPANEL_MODE_ALT
+                                && multipanel->mode < SAITEK_AUTOPILOT_VALUES) {
+                        ap = &multipanel->ap[multipanel->mode];
+                        saitek_counter_add(&ap->value, event->value * ap->step, &ap->limit);
+                        changed = 1;
+                }
+        }
+        if (!changed)
+                return;
+
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        saitek_autopilot_render(multipanel);
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        saitek_proflight_publish_frame(driver_data);
+        saitek_proflight_schedule_output(driver_data);
+}
+
+/*
+ * Feeds the batch of events just decoded to the Radio Panel tuner: the knobs
+ * of a row tune the standby value of the position selected on that row,
+ * ACT/STBY swaps it with the active one, and the displays are re-rendered and
+ * sent whenever a value or a position changed. Called with the input lock held.
+ */
+static void saitek_proflight_tuner(struct proflight *driver_data)
+{
+        struct proflight_radiopanel *radiopanel = driver_data->data.radiopanel;
+        const struct proflight_event *event;
+        struct saitek_radio_value *radio;
+        unsigned long flags;
+        int changed = 0;
+        int mode, outer, tmp;
+        int i;
+
+        if (driver_data->product_id != USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL
+                        || !radiopanel->tuner)
+                return;
+        for (i = 0; i < driver_data->nevents; i++) {
+                event = &driver_data->events[i];
+                if (event->type == PROFLIGHT_EV_SEL) {
+                        changed = 1;
+                        continue;
+                }
+                switch (event->code) {
+                case PROFLIGHT_RP_ACTSTBY0:
+                case PROFLIGHT_RP_INNERKNOB0:
+                case PROFLIGHT_RP_OUTERKNOB0:
+                        mode = radiopanel->mode0;
+                        break;
+                case PROFLIGHT_RP_ACTSTBY1:
+                case PROFLIGHT_RP_INNERKNOB1:
+                case PROFLIGHT_RP_OUTERKNOB1:
+                        mode = radiopanel->mode1;
+                        break;
+                default:
+                        continue;
+                }
+                if (mode < PROFLIGHT_RADIOPANEL_MODE_COM1 || mode >= SAITEK_RADIO_VALUES)
+                        continue;
+                radio = &radiopanel->radio[mode];
+                if (event->type == PROFLIGHT_EV_KEY && event->value) {
+                        tmp = radio->active;
+                        radio->active = radio->standby;
+                        radio->standby = tmp;
+                        changed = 1;
+                } else if (event->type == PROFLIGHT_EV_REL) {
+                        outer = (event->code == PROFLIGHT_RP_OUTERKNOB0
+                                        || event->code == PROFLIGHT_RP_OUTERKNOB1);
+                        radio->standby = saitek_radio_tune(mode, radio->standby, outer,
+                                        event->value, radiopanel->com_833);
+                        changed = 1;
+                }
+        }
+        if (!changed)
+                return;
+
+        SAITEK_OUTPUT_LOCK(&driver_data->output_lock, flags);
+        saitek_tuner_render(radiopanel);
+        SAITEK_OUTPUT_UNLOCK(&driver_data->output_lock, flags);
+        saitek_proflight_publish_frame(driver_data);
+        saitek_proflight_schedule_output(driver_data);
 }
 
 static int saitek_proflight_multipanel_raw_event(
@@ -849,70 +4027,12 @@ static int saitek_proflight_multipanel_raw_event(
 {
         if (report->id != 0 || report->type != 0)
                 return 0; // Uknown report, let it be processed the default way.
-        if (size < 3)
+        if (size < PROFLIGHT_INPUT_REPORT_LEN)
                 return -1; // We expect 3 bytes
-        
-#define SAITEK_ADJUST_COUNTED_BTN(btn,byteno,mask) \
-        if (CHECK(data[byteno] & mask)) { \
-                if (!multipanel->btn) { \
-                        if (multipanel->a ## btn < SAITEK_MAX_BTN) \
-                                multipanel->a ## btn++; \
-                        multipanel->btn = 1; \
-                } \
-        } else { \
-                multipanel->btn = 0; \
-        }
-
-#define SAITEK_ADJUST_COUNTED_ENCDR(btn,up,bytenoup,maskup,valmax,down,bytenodown,maskdown,valmin) \
-        if (CHECK(data[bytenoup] & maskup)) { \
-                if (!multipanel->btn ## _ ## up) { \
-                        if (multipanel->btn < (valmax)) \
-                                multipanel->btn++; \
-                        multipanel->btn ## _ ## up = 1; \
-                } \
-        } else { \
-                multipanel->btn ## _ ## up = 0; \
-        } \
-        if (CHECK(data[bytenodown] & maskdown)) { \
-                if (!multipanel->btn ## _ ## down) \
-                        if (multipanel->btn > (valmin)) \
-                                multipanel->btn--; \
-                        multipanel->btn ## _ ## down = 1; \
-        } else { \
-                multipanel->btn ## _ ## down = 0; \
-        }
-
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Woverflow"
-        // TODO: some kind of a software debouncer
-        SAITEK_ADJUST_COUNTED_BTN(hdg, 1, 0x01);
-        SAITEK_ADJUST_COUNTED_BTN(nav, 1, 0x02);
-        SAITEK_ADJUST_COUNTED_BTN(ias, 1, 0x04);
-        SAITEK_ADJUST_COUNTED_BTN(alt, 1, 0x08);
-        SAITEK_ADJUST_COUNTED_BTN(vs,  1, 0x10);
-        SAITEK_ADJUST_COUNTED_BTN(apr, 1, 0x20);
-        SAITEK_ADJUST_COUNTED_BTN(rev, 1, 0x40);
-        SAITEK_ADJUST_COUNTED_BTN(ap,  0, 0x80); // unnecessary GCC warning on overflow in conversion here
-        SAITEK_ADJUST_COUNTED_ENCDR(flaps,up,2,0x01,SAITEK_MAX_FLAPS,down,2,0x02,SAITEK_MIN_FLAPS);
-        multipanel->auto_throttle = CHECK(data[1] & 0x80); // unnecessary GCC warning on overflow in conversion here
-        SAITEK_ADJUST_COUNTED_ENCDR(pitch_trim,up,2,0x08,SAITEK_MAX_PITCH_TRIM,down,2,0x04,SAITEK_MIN_PITCH_TRIM);
-        SAITEK_ADJUST_COUNTED_ENCDR(knob,right,0,0x20,SAITEK_MAX_KNOB,left,0,0x40,SAITEK_MIN_KNOB);
-        if (data[0] & 0x01)
-                multipanel->mode = MULTIPANEL_MODE_ALT;
-        else if (data[0] & 0x02)
-                multipanel->mode = MULTIPANEL_MODE_VS;
-        else if (data[0] & 0x04)
-                multipanel->mode = MULTIPANEL_MODE_IAS;
-        else if (data[0] & 0x08)
-                multipanel->mode = MULTIPANEL_MODE_HDG;
-        else if (data[0] & 0x10)
-                multipanel->mode = MULTIPANEL_MODE_CRS;
-        else
-                multipanel->mode = 0; // should never occur
-#pragma GCC diagnostic pop
-        
-#undef SAITEK_ADJUST_COUNTED_ENCDR
-#undef SAITEK_ADJUST_COUNTED_BTN
+
+        saitek_proflight_decode(multipanel->parent, multipanel, &saitek_multipanel_decoder,
+                        &multipanel->bits, saitek_report_bits(data));
+        trace_saitek_multipanel_raw_event(hdev, data, multipanel->parent->nevents);
 
         return 1;
 }
@@ -927,85 +4047,12 @@ static int saitek_proflight_radiopanel_raw_event(
                                 " (ID=%i TYPE=%i).", report->id, report->type);
                 return 0; // process the default way
         }
-        if (size < 3)
+        if (size < PROFLIGHT_INPUT_REPORT_LEN)
                 return -1; // we expect 3 bytes
 
-#define SAITEK_ADJUST_COUNTED_BTN(btn,byteno,mask) \
-        if (CHECK(data[byteno] & mask)) { \
-                if (!radiopanel->btn) { \
-                        if (radiopanel->a ## btn < SAITEK_MAX_BTN) \
-                                radiopanel->a ## btn++; \
-                        radiopanel->btn = 1; \
-                } \
-        } else { \
-                radiopanel->btn = 0; \
-        }
-
-#define SAITEK_ADJUST_COUNTED_ENCDR(btn,up,bytenoup,maskup,valmax,down,bytenodown,maskdown,valmin) \
-        if (CHECK(data[bytenoup] & maskup)) { \
-                if (!radiopanel->btn ## _ ## up) { \
-                        if (radiopanel->btn < (valmax)) \
-                                radiopanel->btn++; \
-                        radiopanel->btn ## _ ## up = 1; \
-                } \
-        } else { \
-                radiopanel->btn ## _ ## up = 0; \
-        } \
-        if (CHECK(data[bytenodown] & maskdown)) { \
-                if (!radiopanel->btn ## _ ## down) \
-                        if (radiopanel->btn > (valmin)) \
-                                radiopanel->btn--; \
-                        radiopanel->btn ## _ ## down = 1; \
-        } else { \
-                radiopanel->btn ## _ ## down = 0; \
-        }
-
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Woverflow"
-
-        SAITEK_ADJUST_COUNTED_BTN(actstby0, 1, 0x40);
-        SAITEK_ADJUST_COUNTED_BTN(actstby1, 1, 0x80);
-        SAITEK_ADJUST_COUNTED_ENCDR(innerknob0,right,2,0x01,SAITEK_MAX_KNOB,left,2,0x02,SAITEK_MIN_KNOB);
-        SAITEK_ADJUST_COUNTED_ENCDR(outerknob0,right,2,0x04,SAITEK_MAX_KNOB,left,2,0x08,SAITEK_MIN_KNOB);
-        SAITEK_ADJUST_COUNTED_ENCDR(innerknob1,right,2,0x10,SAITEK_MAX_KNOB,left,2,0x20,SAITEK_MIN_KNOB);
-        SAITEK_ADJUST_COUNTED_ENCDR(outerknob1,right,2,0x40,SAITEK_MAX_KNOB,left,2,0x80,SAITEK_MIN_KNOB);
-        if (data[0] & 0x01)
-                radiopanel->mode0 = RADIOPANEL_MODE_COM1;
-        else if (data[0] & 0x02)
-                radiopanel->mode0 = RADIOPANEL_MODE_COM2;
-        else if (data[0] & 0x04)
-                radiopanel->mode0 = RADIOPANEL_MODE_NAV1;
-        else if (data[0] & 0x08)
-                radiopanel->mode0 = RADIOPANEL_MODE_NAV2;
-        else if (data[0] & 0x10)
-                radiopanel->mode0 = RADIOPANEL_MODE_ADF;
-        else if (data[0] & 0x20)
-                radiopanel->mode0 = RADIOPANEL_MODE_DME;
-        else if (data[0] & 0x40)
-                radiopanel->mode0 = RADIOPANEL_MODE_XPDR;
-        else
-                radiopanel->mode0 = 0; // should never occur
-        if (data[0] & 0x80)
-                radiopanel->mode1 = RADIOPANEL_MODE_COM1;
-        else if (data[1] & 0x01)
-                radiopanel->mode1 = RADIOPANEL_MODE_COM2;
-        else if (data[1] & 0x02)
-                radiopanel->mode1 = RADIOPANEL_MODE_NAV1;
-        else if (data[1] & 0x04)
-                radiopanel->mode1 = RADIOPANEL_MODE_NAV2;
-        else if (data[1] & 0x08)
-                radiopanel->mode1 = RADIOPANEL_MODE_ADF;
-        else if (data[1] & 0x10)
-                radiopanel->mode1 = RADIOPANEL_MODE_DME;
-        else if (data[1] & 0x20)
-                radiopanel->mode1 = RADIOPANEL_MODE_XPDR;
-        else
-                radiopanel->mode1 = 0; // should never occur
-
-#pragma GCC diagnostic pop
-
-#undef SAITEK_ADJUST_COUNTED_ENCDR
-#undef SAITEK_ADJUST_COUNTED_BTN
+        saitek_proflight_decode(radiopanel->parent, radiopanel, &saitek_radiopanel_decoder,
+                        &radiopanel->bits, saitek_report_bits(data));
+        trace_saitek_radiopanel_raw_event(hdev, data, radiopanel->parent->nevents);
 
         return 1;
 }
@@ -1020,55 +4067,25 @@ static int saitek_proflight_switchpanel_raw_event(
                                 " (ID=%i TYPE=%i).", report->id, report->type);
                 return 0; // process the default way
         }
-        if (size < 3)
+        if (size < PROFLIGHT_INPUT_REPORT_LEN)
                 return -1; // we expect 3 bytes
-        
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Woverflow"
-
-        switchpanel->master_bat = (data[0] & 0x01) ? 1 : 0;
-        switchpanel->master_alt = (data[0] & 0x02) ? 1 : 0;
-        switchpanel->avionics   = (data[0] & 0x04) ? 1 : 0;
-        switchpanel->fuel_pump  = (data[0] & 0x08) ? 1 : 0;
-        switchpanel->de_ice     = (data[0] & 0x10) ? 1 : 0;
-        switchpanel->pitot_heat = (data[0] & 0x20) ? 1 : 0;
-        switchpanel->cowl       = (data[0] & 0x40) ? 1 : 0;
-        switchpanel->panel      = (data[0] & 0x80) ? 1 : 0;
-        switchpanel->beacon     = (data[1] & 0x01) ? 1 : 0;
-        switchpanel->nav        = (data[1] & 0x02) ? 1 : 0;
-        switchpanel->strobe     = (data[1] & 0x04) ? 1 : 0;
-        switchpanel->taxi       = (data[1] & 0x08) ? 1 : 0;
-        switchpanel->landing    = (data[1] & 0x10) ? 1 : 0;
-        switchpanel->gear_up    = (data[2] & 0x04) ? 1 : 0;
-        switchpanel->gear_down  = (data[2] & 0x08) ? 1 : 0;
-        if (data[2] & 0x02)
-                switchpanel->mode = SWITCHPANEL_MODE_START;
-        else if (data[2] & 0x01)
-                switchpanel->mode = SWITCHPANEL_MODE_BOTH;
-        else if (data[1] & 0x80)
-                switchpanel->mode = SWITCHPANEL_MODE_LEFT;
-        else if (data[1] & 0x40)
-                switchpanel->mode = SWITCHPANEL_MODE_RIGHT;
-        else if (data[1] & 0x20)
-                switchpanel->mode = SWITCHPANEL_MODE_OFF;
-        else
-                switchpanel->mode = 0; // should never occur
-
-#pragma GCC diagnostic pop
+
+        saitek_proflight_decode(switchpanel->parent, switchpanel, &saitek_switchpanel_decoder,
+                        &switchpanel->bits, saitek_report_bits(data));
+        trace_saitek_switchpanel_raw_event(hdev, data, switchpanel->parent->nevents);
 
         return 1;
 }
 
-static int saitek_proflight_raw_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size)
+/*
+ * Decodes an input report into the panel data and runs the hooks on it.
+ * Called with the input lock held and event_time_ns set.
+ */
+static int saitek_proflight_handle_report(struct proflight *driver_data, struct hid_device *hdev,
+                struct hid_report *report, u8 *data, int size)
 {
-        struct proflight *driver_data;
         int ret_val = -1;
 
-        driver_data = hid_get_drvdata(hdev);
-        if (!driver_data)
-                return -1;
-        
-        SAITEK_LOCK_WRITE(driver_data->lock);
         switch (driver_data->product_id) {
         case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
                 ret_val = saitek_proflight_radiopanel_raw_event(driver_data->data.radiopanel, hdev, report, data, size);
@@ -1080,11 +4097,83 @@ static int saitek_proflight_raw_event(struct hid_device *hdev, struct hid_report
                 ret_val = saitek_proflight_switchpanel_raw_event(driver_data->data.switchpanel, hdev, report, data, size);
                 break;
         }
-        SAITEK_UNLOCK_WRITE(driver_data->lock);
+        saitek_hist_add(&driver_data->stats.decode, ktime_get_ns() - driver_data->event_time_ns);
+        saitek_proflight_flip_pages(driver_data);
+        saitek_proflight_rules(driver_data);
+        saitek_proflight_autopilot(driver_data);
+        saitek_proflight_tuner(driver_data);
+        saitek_proflight_flush_events(driver_data);
+        saitek_hist_add(&driver_data->stats.raw_event_hold, ktime_get_ns() - driver_data->event_time_ns);
+
+        return ret_val;
+}
+
+static int saitek_proflight_raw_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size)
+{
+        struct proflight *driver_data;
+        unsigned long flags;
+        int ret_val;
+        u64 start;
+
+        driver_data = hid_get_drvdata(hdev);
+        if (!driver_data)
+                return -1;
+        trace_saitek_raw_event(hdev, data, size);
+        atomic64_inc(&driver_data->stats.reports);
+
+        // same bits as last time: nothing to decode, nobody to wake up
+        if (report->id == 0 && report->type == 0 && size >= PROFLIGHT_INPUT_REPORT_LEN
+                        && saitek_report_bits(data) == READ_ONCE(driver_data->raw)) {
+                atomic64_inc(&driver_data->stats.duplicate_reports);
+                return 1;
+        }
+        
+        start = ktime_get_ns();
+        SAITEK_INPUT_WRITE_BEGIN(&driver_data->input_lock, flags);
+        driver_data->event_time_ns = ktime_get_ns();
+        saitek_hist_add(&driver_data->stats.raw_event_wait, driver_data->event_time_ns - start);
+        ret_val = saitek_proflight_handle_report(driver_data, hdev, report, data, size);
+        SAITEK_INPUT_WRITE_END(&driver_data->input_lock, flags);
 
         return ret_val;
 }
 
+/*
+ * Takes the changes the debouncer held back, once their window is over.
+ */
+static void saitek_proflight_debounce_work(struct work_struct *work)
+{
+        struct proflight *driver_data;
+        unsigned long flags;
+
+        driver_data = container_of(to_delayed_work(work), struct proflight, debounce_work);
+        SAITEK_INPUT_WRITE_BEGIN(&driver_data->input_lock, flags);
+        driver_data->event_time_ns = ktime_get_ns();
+        switch (driver_data->product_id) {
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_RADIOPANEL:
+                saitek_proflight_decode(driver_data, driver_data->data.radiopanel,
+                                &saitek_radiopanel_decoder, &driver_data->data.radiopanel->bits,
+                                driver_data->raw);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_MULTIPANEL:
+                saitek_proflight_decode(driver_data, driver_data->data.multipanel,
+                                &saitek_multipanel_decoder, &driver_data->data.multipanel->bits,
+                                driver_data->raw);
+                break;
+        case USB_DEVICE_ID_SAITEK_PROFLIGHT_SWITCHPANEL:
+                saitek_proflight_decode(driver_data, driver_data->data.switchpanel,
+                                &saitek_switchpanel_decoder, &driver_data->data.switchpanel->bits,
+                                driver_data->raw);
+                break;
+        }
+        saitek_proflight_flip_pages(driver_data);
+        saitek_proflight_rules(driver_data);
+        saitek_proflight_autopilot(driver_data);
+        saitek_proflight_tuner(driver_data);
+        saitek_proflight_flush_events(driver_data);
+        SAITEK_INPUT_WRITE_END(&driver_data->input_lock, flags);
+}
+
 static int saitek_proflight_event(struct hid_device *hdev, struct hid_field *field, struct hid_usage *usage, __s32 value)
 {
         return 1; // -1 = error, 0 = continue processing, 1 = no further processing
@@ -1097,7 +4186,13 @@ static const struct hid_device_id saitek_proflight_devices[] = {
         { }
 };
 
+/*
+ * hid-saitek-proflight-test.c builds this file into the KUnit test module,
+ * which must neither register the driver nor get loaded for the panels.
+ */
+#ifndef SAITEK_PROFLIGHT_KUNIT_TEST
 MODULE_DEVICE_TABLE(hid, saitek_proflight_devices);
+#endif
 
 static struct hid_driver saitek_proflight_driver = {
         .name = "saitek_proflight",
@@ -1106,15 +4201,22 @@ static struct hid_driver saitek_proflight_driver = {
         .remove = saitek_proflight_remove,
         .raw_event = saitek_proflight_raw_event,
         .event = saitek_proflight_event,
+        .driver = {
+                .probe_type = PROBE_PREFER_ASYNCHRONOUS,
+        },
 };
 
+#ifndef SAITEK_PROFLIGHT_KUNIT_TEST
 static int __init saitek_proflight_init(void)
 {
         int ret;
         
+        saitek_proflight_debugfs_root = debugfs_create_dir("saitek_proflight", NULL);
         ret = hid_register_driver(&saitek_proflight_driver);
-        if (ret)
+        if (ret) {
                 printk(KERN_ERR "Cannot register Saitek Pro Flight driver (err %i).\n", ret);
+                debugfs_remove_recursive(saitek_proflight_debugfs_root);
+        }
 
         return ret;
 }
@@ -1122,6 +4224,7 @@ static int __init saitek_proflight_init(void)
 static void __exit saitek_proflight_exit(void)
 {
         hid_unregister_driver(&saitek_proflight_driver);
+        debugfs_remove_recursive(saitek_proflight_debugfs_root);
 }
 
 module_init(saitek_proflight_init);
@@ -1130,3 +4233,4 @@ module_exit(saitek_proflight_exit);
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Paweł A. Ryszawa <pablo53@poczta.onet.eu>");
 MODULE_DESCRIPTION("A driver for Saitek ProFlight series of HIDs.");
+#endif
@@ -0,0 +1,233 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later WITH Linux-syscall-note */
+/*
+ * Userspace interface of the HID driver for Saitek Pro Flight series devices.
+ *
+ * Copyright (c) 2020 Paweł A. Ryszawa
+ */
+
+#ifndef _HID_SAITEK_PROFLIGHT_H
+#define _HID_SAITEK_PROFLIGHT_H
+
+#include <linux/types.h>
+
+/*
+ * Selector positions (value of PROFLIGHT_EV_SEL events).
+ */
+
+#define PROFLIGHT_RADIOPANEL_MODE_COM1 1
+#define PROFLIGHT_RADIOPANEL_MODE_COM2 2
+#define PROFLIGHT_RADIOPANEL_MODE_NAV1 3
+#define PROFLIGHT_RADIOPANEL_MODE_NAV2 4
+#define PROFLIGHT_RADIOPANEL_MODE_ADF  5
+#define PROFLIGHT_RADIOPANEL_MODE_DME  6
+#define PROFLIGHT_RADIOPANEL_MODE_XPDR 7
+
+#define PROFLIGHT_MULTIPANEL_MODE_ALT 1
+#define PROFLIGHT_MULTIPANEL_MODE_VS  2
+#define PROFLIGHT_MULTIPANEL_MODE_IAS 3
+#define PROFLIGHT_MULTIPANEL_MODE_HDG 4
+#define PROFLIGHT_MULTIPANEL_MODE_CRS 5
+
+#define PROFLIGHT_SWITCHPANEL_MODE_START 5
+#define PROFLIGHT_SWITCHPANEL_MODE_BOTH  4
+#define PROFLIGHT_SWITCHPANEL_MODE_LEFT  3
+#define PROFLIGHT_SWITCHPANEL_MODE_RIGHT 2
+#define PROFLIGHT_SWITCHPANEL_MODE_OFF   1
+
+/*
+ * Events read from /dev/proflightN. Every input report that changed anything
+ * yields a batch of events terminated by a PROFLIGHT_SYN_REPORT event, all of
+ * them stamped with the (CLOCK_MONOTONIC) time the report was received.
+ * Each open file has its own queue (see the queue_depth module parameter);
+ * a batch that does not fit is dropped as a whole, and the next batch is
+ * preceded by a PROFLIGHT_SYN_DROPPED event with the number of lost events.
+ */
+
+#define PROFLIGHT_EV_SYN 0 /* code: PROFLIGHT_SYN_* */
+#define PROFLIGHT_EV_KEY 1 /* button or switch; value: 1 - pressed/on, 0 - released/off */
+/* encoder detent; value: > 0 - right/up, < 0 - left/down (see encoder_accel_*) */
+#define PROFLIGHT_EV_REL 2
+/* rotary selector; code: PROFLIGHT_SEL_*, value: PROFLIGHT_*_MODE_* */
+#define PROFLIGHT_EV_SEL 3
+
+#define PROFLIGHT_SYN_REPORT  0 /* end of batch */
+#define PROFLIGHT_SYN_DROPPED 1 /* value: events lost before this one */
+
+struct proflight_event {
+        __u64 time_ns;
+        __u16 type;
+        __u16 code;
+        __s32 value;
+};
+
+/*
+ * Event codes. Buttons, switches and encoders are numbered after the bit
+ * they occupy in the 3-byte input report (byte * 8 + bit); an encoder is
+ * numbered after its right/up bit.
+ */
+
+#define PROFLIGHT_SEL_0 0 /* Radio Panel upper, Multi Panel and Switch Panel selector */
+#define PROFLIGHT_SEL_1 1 /* Radio Panel lower selector */
+
+#define PROFLIGHT_RP_ACTSTBY0   14
+#define PROFLIGHT_RP_ACTSTBY1   15
+#define PROFLIGHT_RP_INNERKNOB0 16
+#define PROFLIGHT_RP_OUTERKNOB0 18
+#define PROFLIGHT_RP_INNERKNOB1 20
+#define PROFLIGHT_RP_OUTERKNOB1 22
+
+#define PROFLIGHT_MP_KNOB          5
+#define PROFLIGHT_MP_AP            7
+#define PROFLIGHT_MP_HDG           8
+#define PROFLIGHT_MP_NAV           9
+#define PROFLIGHT_MP_IAS          10
+#define PROFLIGHT_MP_ALT          11
+#define PROFLIGHT_MP_VS           12
+#define PROFLIGHT_MP_APR          13
+#define PROFLIGHT_MP_REV          14
+#define PROFLIGHT_MP_AUTO_THROTTLE 15
+#define PROFLIGHT_MP_FLAPS        16
+#define PROFLIGHT_MP_PITCH_TRIM   19
+
+#define PROFLIGHT_SP_MASTER_BAT  0
+#define PROFLIGHT_SP_MASTER_ALT  1
+#define PROFLIGHT_SP_AVIONICS    2
+#define PROFLIGHT_SP_FUEL_PUMP   3
+#define PROFLIGHT_SP_DE_ICE      4
+#define PROFLIGHT_SP_PITOT_HEAT  5
+#define PROFLIGHT_SP_COWL        6
+#define PROFLIGHT_SP_PANEL       7
+#define PROFLIGHT_SP_BEACON      8
+#define PROFLIGHT_SP_NAV         9
+#define PROFLIGHT_SP_STROBE     10
+#define PROFLIGHT_SP_TAXI       11
+#define PROFLIGHT_SP_LANDING    12
+#define PROFLIGHT_SP_GEAR_UP    18
+#define PROFLIGHT_SP_GEAR_DOWN  19
+
+#define PROFLIGHT_MAX_CODES 24
+
+/*
+ * Selector positions in the input report, as one bit each (byte * 8 + bit),
+ * for whoever has to produce the reports (e.g. a uhid based emulator).
+ * Radio Panel upper selector: COM1 0, COM2 1, NAV1 2, NAV2 3, ADF 4, DME 5,
+ * XPDR 6; lower selector: COM1 7, COM2 8, NAV1 9, NAV2 10, ADF 11, DME 12,
+ * XPDR 13.
+ * Multi Panel: ALT 0, VS 1, IAS 2, HDG 3, CRS 4.
+ * Switch Panel: OFF 13, RIGHT 14, LEFT 15, BOTH 16, START 17.
+ * An encoder's left/down bit follows its right/up bit, except for the Multi
+ * Panel pitch trim (down 18, up 19).
+ * Display/LED updates arrive as SET_REPORT requests for feature report 0,
+ * carrying the frame described below after the report ID.
+ */
+#define PROFLIGHT_INPUT_REPORT_LEN 3
+
+/*
+ * Display/LED frames, as written to the binary "frame" sysfs attribute:
+ * the feature report without the report ID.
+ *
+ * Radio Panel (22 bytes): 4 x 5 digits (upper left, upper right, lower left,
+ * lower right), 2 bytes of zeros.
+ * Multi Panel (12 bytes): 2 x 5 digits (upper, lower),
+ * PROFLIGHT_MULTIPANEL_LIGHT_* bits, 1 byte of zero.
+ * Switch Panel (1 byte): PROFLIGHT_SWITCHPANEL_LIGHT_* bits.
+ *
+ * A digit is 0-9, PROFLIGHT_PANEL_DIGIT_MINUS or PROFLIGHT_PANEL_DIGIT_NULL
+ * (blank); on the Radio Panel PROFLIGHT_PANEL_DIGIT_DOT may be or-ed with it
+ * to light the dot.
+ */
+
+#define PROFLIGHT_RADIOPANEL_FRAME_LEN  22
+#define PROFLIGHT_MULTIPANEL_FRAME_LEN  12
+#define PROFLIGHT_SWITCHPANEL_FRAME_LEN 1
+
+#define PROFLIGHT_PANEL_DIGIT_MINUS 0x0e
+#define PROFLIGHT_PANEL_DIGIT_DOT   0xd0
+#define PROFLIGHT_PANEL_DIGIT_NULL  0x0f
+
+#define PROFLIGHT_MULTIPANEL_LIGHT_AP  0x01
+#define PROFLIGHT_MULTIPANEL_LIGHT_HDG 0x02
+#define PROFLIGHT_MULTIPANEL_LIGHT_NAV 0x04
+#define PROFLIGHT_MULTIPANEL_LIGHT_IAS 0x08
+#define PROFLIGHT_MULTIPANEL_LIGHT_ALT 0x10
+#define PROFLIGHT_MULTIPANEL_LIGHT_VS  0x20
+#define PROFLIGHT_MULTIPANEL_LIGHT_APR 0x40
+#define PROFLIGHT_MULTIPANEL_LIGHT_REV 0x80
+
+#define PROFLIGHT_SWITCHPANEL_LIGHT_N_GREEN 0x01
+#define PROFLIGHT_SWITCHPANEL_LIGHT_L_GREEN 0x02
+#define PROFLIGHT_SWITCHPANEL_LIGHT_R_GREEN 0x04
+#define PROFLIGHT_SWITCHPANEL_LIGHT_N_RED   0x08
+#define PROFLIGHT_SWITCHPANEL_LIGHT_L_RED   0x10
+#define PROFLIGHT_SWITCHPANEL_LIGHT_R_RED   0x20
+
+/*
+ * Display/LED pages, as written to the binary "pages" sysfs attribute: one
+ * frame per selector position (PROFLIGHT_*_MODE_*), page n at offset
+ * n * PROFLIGHT_FRAME_LEN. When a selector moves to a position whose page has
+ * been written, the page replaces the shadow right away: the whole frame on
+ * the Multi Panel and the Switch Panel, only the row of that selector on the
+ * Radio Panel. One zero frame written to page 0 (no position) drops all pages.
+ * Several pages can be written at once as they read back: each page padded
+ * with zeros to PROFLIGHT_FRAME_LEN, page 0 all zeros, and a zero frame for a
+ * page never written (which it drops). Any other write fails with EINVAL.
+ */
+
+#define PROFLIGHT_PAGES 8
+
+/*
+ * Output rules, as written to the binary "rules" sysfs attribute: an array of
+ * at most PROFLIGHT_MAX_RULES struct proflight_rule, replacing the whole
+ * table (rules of type PROFLIGHT_EV_SYN are ignored, so one such rule clears
+ * it). Every decoded event matching a rule changes the display/LED shadow
+ * right in the input path, e.g. gear down -> gear lights green:
+ *   { PROFLIGHT_EV_KEY, PROFLIGHT_SP_GEAR_DOWN, 1, 0, PROFLIGHT_RULE_SET, 0, 0x3f, 0x07 }
+ * or AP button -> AP light toggles:
+ *   { PROFLIGHT_EV_KEY, PROFLIGHT_MP_AP, 1, 0, PROFLIGHT_RULE_TOGGLE, 10,
+ *     PROFLIGHT_MULTIPANEL_LIGHT_AP }
+ */
+
+#define PROFLIGHT_MAX_RULES 64
+
+#define PROFLIGHT_RULE_SET    0 /* frame[offset] = (frame[offset] & ~mask) | (bits & mask) */
+#define PROFLIGHT_RULE_TOGGLE 1 /* frame[offset] ^= mask */
+
+#define PROFLIGHT_RULE_ANY_VALUE 0x01 /* match the event whatever its value */
+
+struct proflight_rule {
+        __u16 type; /* of the event matched: PROFLIGHT_EV_KEY, _REL or _SEL */
+        __u16 code; /* of the event matched */
+        __s32 value; /* of the event matched */
+        __u8 flags; /* PROFLIGHT_RULE_ANY_VALUE */
+        __u8 action; /* PROFLIGHT_RULE_* */
+        __u8 offset; /* of the frame byte changed */
+        __u8 mask; /* bits of it changed */
+        __u8 bits; /* PROFLIGHT_RULE_SET: their new value */
+        __u8 reserved[3]; /* zero */
+};
+
+/*
+ * Panel state, mapped read-only by mmap()ing one page of /dev/proflightN.
+ * The page is updated in place: seq is odd while an update is in progress,
+ * so a reader has to load seq (with acquire semantics), copy what it needs
+ * and retry if seq was odd or has changed meanwhile.
+ */
+
+#define PROFLIGHT_STATE_VERSION 1
+
+#define PROFLIGHT_FRAME_LEN PROFLIGHT_RADIOPANEL_FRAME_LEN /* the longest frame */
+
+struct proflight_state {
+        __u32 seq;
+        __u32 version; /* PROFLIGHT_STATE_VERSION */
+        __u32 product_id;
+        __u32 mode; /* 'R' or 'N', as written to the proflight sysfs attribute */
+        __u64 time_ns; /* arrival of the last report that changed anything */
+        __u32 keys; /* bit n - state of the button or switch with code n */
+        __s32 selectors[2]; /* indexed by PROFLIGHT_SEL_* */
+        __u32 presses[PROFLIGHT_MAX_CODES]; /* presses of a button since probe, by code */
+        __s32 encoders[PROFLIGHT_MAX_CODES]; /* detents of an encoder since probe, by code */
+        __u8 frame[PROFLIGHT_FRAME_LEN]; /* display/LED shadow, feature report layout */
+};
+
+#endif /* _HID_SAITEK_PROFLIGHT_H */
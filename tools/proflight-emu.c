@@ -0,0 +1,768 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Emulator of Saitek Pro Flight panels on top of /dev/uhid, and a latency
+ * benchmark of the hid-saitek-proflight driver interfaces.
+ *
+ * Copyright (c) 2020 Paweł A. Ryszawa
+ */
+
+/*
+ * proflight-emu [-p radio|multi|switch] [-l log] [-b] [-n count] [-i interval_us]
+ *
+ * Creates a virtual 0x06a3:0x0d05/0x0d06/0x0d67 device, which the driver
+ * binds to like a real one. The device answers GET_REPORT with the last input
+ * report and acknowledges every SET_REPORT, recording it (time in ns, report
+ * number, bytes) to the log file, stdout by default.
+ *
+ * Without -b, every line read from stdin holding 6 hex digits (the 3 report
+ * bytes, see PROFLIGHT_INPUT_REPORT_LEN) is sent as an input report.
+ *
+ * With -b, count input reports or display/LED writes are timed against every
+ * driver interface, one interface at a time, interval_us apart (more than
+ * debounce_key_us, so that no change is deferred), and the percentiles are
+ * printed in microseconds:
+ *   chardev   - input report to its PROFLIGHT_SYN_REPORT read from /dev/proflightN
+ *   evdev     - input report to its SYN_REPORT read from the input device
+ *   state     - input report to the update of the mmap()ed state page
+ *   rules     - input report to the SET_REPORT of an output rule it matches
+ *   proflight - write() of the "proflight" sysfs attribute to its SET_REPORT
+ *   frame     - write() of the "frame" sysfs attribute to its SET_REPORT
+ *   led       - write() of an LED class brightness to its SET_REPORT
+ *
+ * Needs root (or access to /dev/uhid, the sysfs attributes and the device
+ * nodes) and the hid-saitek-proflight module loaded.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <linux/input.h>
+#include <linux/uhid.h>
+
+#include "../hid-saitek-proflight.h"
+
+#define USB_VENDOR_ID_SAITEK 0x06a3
+
+#define EMU_SET_REPORTS 64 // arrival times kept, a power of 2
+#define EMU_TIMEOUT_NS 1000000000ULL
+
+struct emu_panel {
+        const char *name;
+        __u32 product;
+        __u8 feature_len; // feature report length, without the report ID
+        __u32 rest; // input bits at rest: every selector in its first position
+        __u32 key; // the bit toggled by the input benchmarks
+        struct proflight_rule rule; // toggles a light on every change of key
+};
+
+static const struct emu_panel emu_panels[] = {
+        {
+                .name = "radio",
+                .product = 0x0d05,
+                .feature_len = PROFLIGHT_RADIOPANEL_FRAME_LEN,
+                .rest = 1 << 0 | 1 << 7, // COM1, COM1
+                .key = 1 << PROFLIGHT_RP_ACTSTBY0,
+                .rule = { PROFLIGHT_EV_KEY, PROFLIGHT_RP_ACTSTBY0, 0, PROFLIGHT_RULE_ANY_VALUE,
+                        PROFLIGHT_RULE_TOGGLE, 4, PROFLIGHT_PANEL_DIGIT_DOT },
+        },
+        {
+                .name = "multi",
+                .product = 0x0d06,
+                .feature_len = PROFLIGHT_MULTIPANEL_FRAME_LEN,
+                .rest = 1 << 0, // ALT
+                .key = 1 << PROFLIGHT_MP_AP,
+                .rule = { PROFLIGHT_EV_KEY, PROFLIGHT_MP_AP, 0, PROFLIGHT_RULE_ANY_VALUE,
+                        PROFLIGHT_RULE_TOGGLE, 10, PROFLIGHT_MULTIPANEL_LIGHT_AP },
+        },
+        {
+                .name = "switch",
+                .product = 0x0d67,
+                .feature_len = PROFLIGHT_SWITCHPANEL_FRAME_LEN,
+                .rest = 1 << 13, // OFF
+                .key = 1 << PROFLIGHT_SP_MASTER_BAT,
+                .rule = { PROFLIGHT_EV_KEY, PROFLIGHT_SP_MASTER_BAT, 0, PROFLIGHT_RULE_ANY_VALUE,
+                        PROFLIGHT_RULE_TOGGLE, 0, PROFLIGHT_SWITCHPANEL_LIGHT_N_GREEN },
+        },
+};
+
+static const struct emu_panel *panel;
+static int uhid_fd;
+static FILE *log_file;
+static char uniq[64];
+static char hid_dir[PATH_MAX / 2]; // /sys/bus/hid/devices/<the emulated device>
+
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER; // of uhid_fd
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER; // of what follows
+static pthread_cond_t cond;
+static __u32 input_bits; // the last input report sent
+static unsigned long set_reports;
+static __u64 set_report_ns[EMU_SET_REPORTS]; // by set_reports % EMU_SET_REPORTS
+
+static void die(const char *what)
+{
+        perror(what);
+        exit(1);
+}
+
+static __u64 now_ns(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_us(unsigned int us)
+{
+        struct timespec ts = { us / 1000000, us % 1000000 * 1000 };
+
+        while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+                ;
+}
+
+static void uhid_send(struct uhid_event *ev)
+{
+        ssize_t res;
+
+        pthread_mutex_lock(&write_lock);
+        res = write(uhid_fd, ev, sizeof(*ev));
+        pthread_mutex_unlock(&write_lock);
+        if (res < 0)
+                die("write /dev/uhid");
+}
+
+/*
+ * Vendor defined collection: a 3-byte input report and a feature report of
+ * the frame length, both unnumbered, as the driver expects them.
+ */
+static size_t emu_descriptor(__u8 *rd)
+{
+        const __u8 head[] = {
+                0x06, 0x00, 0xff, // Usage Page (Vendor Defined 0xFF00)
+                0x09, 0x01, // Usage (0x01)
+                0xa1, 0x01, // Collection (Application)
+                0x15, 0x00, //   Logical Minimum (0)
+                0x26, 0xff, 0x00, //   Logical Maximum (255)
+                0x75, 0x08, //   Report Size (8)
+                0x09, 0x01, //   Usage (0x01)
+                0x95, PROFLIGHT_INPUT_REPORT_LEN, //   Report Count (3)
+                0x81, 0x02, //   Input (Data, Variable, Absolute)
+                0x09, 0x02, //   Usage (0x02)
+                0x95, 0x00, //   Report Count (feature_len, patched below)
+                0xb1, 0x02, //   Feature (Data, Variable, Absolute)
+                0xc0, // End Collection
+        };
+
+        memcpy(rd, head, sizeof(head));
+        rd[23] = panel->feature_len;
+        return sizeof(head);
+}
+
+static void emu_create(void)
+{
+        struct uhid_event ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.type = UHID_CREATE2;
+        snprintf((char *)ev.u.create2.name, sizeof(ev.u.create2.name),
+                        "Saitek Pro Flight %s panel (emulated)", panel->name);
+        snprintf((char *)ev.u.create2.phys, sizeof(ev.u.create2.phys), "proflight-emu");
+        snprintf((char *)ev.u.create2.uniq, sizeof(ev.u.create2.uniq), "%s", uniq);
+        ev.u.create2.rd_size = emu_descriptor(ev.u.create2.rd_data);
+        ev.u.create2.bus = BUS_USB; // the driver matches USB devices only
+        ev.u.create2.vendor = USB_VENDOR_ID_SAITEK;
+        ev.u.create2.product = panel->product;
+        ev.u.create2.version = 0x0100;
+        uhid_send(&ev);
+}
+
+static void emu_destroy(void)
+{
+        struct uhid_event ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.type = UHID_DESTROY;
+        uhid_send(&ev);
+}
+
+/*
+ * Sends an input report; returns the time it was handed to the kernel.
+ */
+static __u64 emu_input(__u32 bits)
+{
+        struct uhid_event ev;
+        __u64 t;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.type = UHID_INPUT2;
+        ev.u.input2.size = PROFLIGHT_INPUT_REPORT_LEN;
+        ev.u.input2.data[0] = bits;
+        ev.u.input2.data[1] = bits >> 8;
+        ev.u.input2.data[2] = bits >> 16;
+        pthread_mutex_lock(&lock);
+        input_bits = bits;
+        pthread_mutex_unlock(&lock);
+        t = now_ns();
+        uhid_send(&ev);
+        return t;
+}
+
+static void emu_log_set_report(__u64 t, const struct uhid_set_report_req *req)
+{
+        int i;
+
+        if (!log_file)
+                return;
+        fprintf(log_file, "%llu.%09llu SET_REPORT %u:", t / 1000000000ULL,
+                        t % 1000000000ULL, req->rnum);
+        for (i = 0; i < req->size && i < UHID_DATA_MAX; i++)
+                fprintf(log_file, " %02x", req->data[i]);
+        fputc('\n', log_file);
+        fflush(log_file);
+}
+
+/*
+ * Answers the driver's requests. GET_REPORT and SET_REPORT block the driver
+ * until they are answered, so this thread does nothing else.
+ */
+static void *emu_thread(void *arg __attribute__((unused)))
+{
+        struct uhid_event ev, reply;
+        ssize_t res;
+        __u64 t;
+
+        for (;;) {
+                res = read(uhid_fd, &ev, sizeof(ev));
+                if (res < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        die("read /dev/uhid");
+                }
+                t = now_ns();
+                memset(&reply, 0, sizeof(reply));
+                switch (ev.type) {
+                case UHID_GET_REPORT:
+                        reply.type = UHID_GET_REPORT_REPLY;
+                        reply.u.get_report_reply.id = ev.u.get_report.id;
+                        if (ev.u.get_report.rtype != UHID_INPUT_REPORT) {
+                                reply.u.get_report_reply.err = EIO;
+                        } else {
+                                // the report ID byte (0) comes first, as with usbhid
+                                reply.u.get_report_reply.size = PROFLIGHT_INPUT_REPORT_LEN + 1;
+                                pthread_mutex_lock(&lock);
+                                reply.u.get_report_reply.data[1] = input_bits;
+                                reply.u.get_report_reply.data[2] = input_bits >> 8;
+                                reply.u.get_report_reply.data[3] = input_bits >> 16;
+                                pthread_mutex_unlock(&lock);
+                        }
+                        uhid_send(&reply);
+                        break;
+                case UHID_SET_REPORT:
+                        reply.type = UHID_SET_REPORT_REPLY;
+                        reply.u.set_report_reply.id = ev.u.set_report.id;
+                        uhid_send(&reply);
+                        pthread_mutex_lock(&lock);
+                        set_report_ns[set_reports % EMU_SET_REPORTS] = t;
+                        set_reports++;
+                        pthread_cond_broadcast(&cond);
+                        pthread_mutex_unlock(&lock);
+                        emu_log_set_report(t, &ev.u.set_report);
+                        break;
+                }
+        }
+        return NULL;
+}
+
+static unsigned long emu_set_reports(void)
+{
+        unsigned long n;
+
+        pthread_mutex_lock(&lock);
+        n = set_reports;
+        pthread_mutex_unlock(&lock);
+        return n;
+}
+
+/*
+ * Waits for the first SET_REPORT after the seen ones; returns its arrival
+ * time, or 0 if none came within EMU_TIMEOUT_NS.
+ */
+static __u64 emu_wait_set_report(unsigned long seen)
+{
+        __u64 deadline = now_ns() + EMU_TIMEOUT_NS;
+        struct timespec ts = { deadline / 1000000000ULL, deadline % 1000000000ULL };
+        __u64 t = 0;
+
+        pthread_mutex_lock(&lock);
+        while (set_reports == seen)
+                if (pthread_cond_timedwait(&cond, &lock, &ts) == ETIMEDOUT)
+                        break;
+        if (set_reports != seen)
+                t = set_report_ns[seen % EMU_SET_REPORTS];
+        pthread_mutex_unlock(&lock);
+        return t;
+}
+
+/*
+ * Path of the only file matching pattern (relative to hid_dir), or NULL.
+ */
+static char *emu_find(const char *pattern, char *path, size_t size)
+{
+        char full[PATH_MAX];
+        glob_t g;
+        int found;
+
+        snprintf(full, sizeof(full), "%s/%s", hid_dir, pattern);
+        if (glob(full, 0, NULL, &g))
+                return NULL;
+        found = g.gl_pathc > 0;
+        if (found)
+                snprintf(path, size, "%s", g.gl_pathv[0]);
+        globfree(&g);
+        return found ? path : NULL;
+}
+
+/*
+ * Finds the HID device by its uniq string and waits for the driver to bind.
+ */
+static void emu_wait_bound(void)
+{
+        char path[PATH_MAX], line[256];
+        glob_t g;
+        size_t i;
+        FILE *f;
+        int tries;
+
+        for (tries = 0; tries < 100 && !hid_dir[0]; tries++) {
+                if (!glob("/sys/bus/hid/devices/*/uevent", 0, NULL, &g)) {
+                        for (i = 0; i < g.gl_pathc && !hid_dir[0]; i++) {
+                                f = fopen(g.gl_pathv[i], "r");
+                                if (!f)
+                                        continue;
+                                while (fgets(line, sizeof(line), f))
+                                        if (!strncmp(line, "HID_UNIQ=", 9)
+                                                        && !strncmp(line + 9, uniq, strlen(uniq))
+                                                        && line[9 + strlen(uniq)] == '\n') {
+                                                snprintf(hid_dir, sizeof(hid_dir), "%.*s",
+                                                                (int)(strlen(g.gl_pathv[i]) - 7),
+                                                                g.gl_pathv[i]);
+                                                break;
+                                        }
+                                fclose(f);
+                        }
+                        globfree(&g);
+                }
+                if (!hid_dir[0])
+                        sleep_us(50000);
+        }
+        if (!hid_dir[0]) {
+                fprintf(stderr, "The emulated device did not show up in /sys/bus/hid.\n");
+                exit(1);
+        }
+        for (tries = 0; tries < 100 && !emu_find("misc/proflight*", path, sizeof(path)); tries++)
+                sleep_us(50000);
+        if (tries == 100) {
+                fprintf(stderr, "hid-saitek-proflight did not bind to %s.\n", hid_dir);
+                exit(1);
+        }
+        sleep_us(200000); // let the bring-up work send its report and read the state
+}
+
+static int emu_compare(const void *a, const void *b)
+{
+        __u64 x = *(const __u64 *)a, y = *(const __u64 *)b;
+
+        return x < y ? -1 : x > y;
+}
+
+static void emu_report(const char *name, __u64 *samples, unsigned int n, unsigned int lost)
+{
+        static const unsigned int per10k[] = { 5000, 9000, 9900, 9990 };
+        unsigned int i;
+
+        if (!n) {
+                printf("%-10s no samples (%u lost)\n", name, lost);
+                return;
+        }
+        qsort(samples, n, sizeof(*samples), emu_compare);
+        printf("%-10s %6u %6u %9.1f", name, n, lost, samples[0] / 1000.0);
+        // nearest rank
+        for (i = 0; i < sizeof(per10k) / sizeof(per10k[0]); i++)
+                printf(" %9.1f", samples[((__u64)n * per10k[i] + 9999) / 10000 - 1] / 1000.0);
+        printf(" %9.1f\n", samples[n - 1] / 1000.0);
+}
+
+static void emu_drain(int fd)
+{
+        char buf[1024];
+        int flags = fcntl(fd, F_GETFL);
+
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        while (read(fd, buf, sizeof(buf)) > 0)
+                ;
+        fcntl(fd, F_SETFL, flags);
+}
+
+/*
+ * Reads from fd until a record of size len for which is_end() holds arrives;
+ * returns 0, or -1 on error or after EMU_TIMEOUT_NS.
+ */
+static int emu_read_until(int fd, size_t len, int (*is_end)(const void *))
+{
+        char buf[64 * sizeof(struct input_event)];
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        ssize_t res;
+        size_t i;
+
+        for (;;) {
+                if (poll(&pfd, 1, EMU_TIMEOUT_NS / 1000000) <= 0)
+                        return -1;
+                res = read(fd, buf, sizeof(buf) - sizeof(buf) % len);
+                if (res < 0)
+                        return -1;
+                for (i = 0; i + len <= (size_t)res; i += len)
+                        if (is_end(buf + i))
+                                return 0;
+        }
+}
+
+static int emu_chardev_end(const void *p)
+{
+        const struct proflight_event *event = p;
+
+        return event->type == PROFLIGHT_EV_SYN && event->code == PROFLIGHT_SYN_REPORT;
+}
+
+static int emu_evdev_end(const void *p)
+{
+        const struct input_event *event = p;
+
+        return event->type == EV_SYN && event->code == SYN_REPORT;
+}
+
+enum emu_input_sink { EMU_CHARDEV, EMU_EVDEV, EMU_STATE, EMU_RULES };
+
+static void emu_bench_input(enum emu_input_sink sink, const char *name, const char *node,
+                unsigned int count, unsigned int interval_us)
+{
+        struct proflight_state *state = NULL;
+        __u64 *samples, t0, t1;
+        unsigned int i, n = 0, lost = 0;
+        unsigned long seen;
+        __u32 bits = panel->rest, seq;
+        int fd, res;
+
+        fd = open(node, O_RDONLY);
+        if (fd < 0) {
+                printf("%-10s %s: %s\n", name, node, strerror(errno));
+                return;
+        }
+        if (sink == EMU_STATE) {
+                state = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+                if (state == MAP_FAILED) {
+                        printf("%-10s mmap: %s\n", name, strerror(errno));
+                        close(fd);
+                        return;
+                }
+        }
+        samples = calloc(count, sizeof(*samples));
+        if (!samples)
+                die("calloc");
+        emu_drain(fd);
+        for (i = 0; i < count; i++) {
+                bits ^= panel->key;
+                seen = emu_set_reports();
+                seq = state ? __atomic_load_n(&state->seq, __ATOMIC_ACQUIRE) : 0;
+                t0 = emu_input(bits);
+                t1 = 0;
+                switch (sink) {
+                case EMU_CHARDEV:
+                        res = emu_read_until(fd, sizeof(struct proflight_event), emu_chardev_end);
+                        t1 = res ? 0 : now_ns();
+                        break;
+                case EMU_EVDEV:
+                        res = emu_read_until(fd, sizeof(struct input_event), emu_evdev_end);
+                        t1 = res ? 0 : now_ns();
+                        break;
+                case EMU_STATE:
+                        // busy wait: a reader of the page polls it the same way
+                        while (now_ns() - t0 < EMU_TIMEOUT_NS) {
+                                __u32 s = __atomic_load_n(&state->seq, __ATOMIC_ACQUIRE);
+
+                                if (s != seq && !(s & 1)) {
+                                        t1 = now_ns();
+                                        break;
+                                }
+                        }
+                        break;
+                case EMU_RULES:
+                        t1 = emu_wait_set_report(seen);
+                        break;
+                }
+                if (t1)
+                        samples[n++] = t1 - t0;
+                else
+                        lost++;
+                emu_drain(fd);
+                sleep_us(interval_us);
+        }
+        emu_report(name, samples, n, lost);
+        free(samples);
+        if (state)
+                munmap(state, sysconf(_SC_PAGESIZE));
+        close(fd);
+}
+
+static void emu_digits(__u8 *digits, unsigned int value)
+{
+        int i;
+
+        for (i = 4; i >= 0; i--, value /= 10)
+                digits[i] = value % 10;
+}
+
+enum emu_output_source { EMU_TEXT, EMU_FRAME, EMU_LED };
+
+/*
+ * Builds the i-th write for the source; consecutive writes always differ, also
+ * from the last one of the previous source, so that none of them is skipped as
+ * a repeated report.
+ */
+static size_t emu_output_buf(enum emu_output_source source, unsigned int i, char *buf, size_t size)
+{
+        unsigned int v = (i + (source == EMU_FRAME ? 50000 : 0)) % 100000;
+        int j;
+
+        switch (source) {
+        case EMU_TEXT:
+                switch (panel->product) {
+                case 0x0d05:
+                        return snprintf(buf, size, "%05u      %05u      %05u      %05u       ",
+                                        v, v, v, v);
+                case 0x0d06:
+                        return snprintf(buf, size, "%05u %05u 00000000  ", v, v);
+                default:
+                        return snprintf(buf, size, i & 1 ? "RRR" : "GGG");
+                }
+        case EMU_FRAME:
+                memset(buf, 0, panel->feature_len);
+                switch (panel->product) {
+                case 0x0d05:
+                        for (j = 0; j < 4; j++)
+                                emu_digits((__u8 *)buf + 5 * j, v);
+                        break;
+                case 0x0d06:
+                        emu_digits((__u8 *)buf, v);
+                        emu_digits((__u8 *)buf + 5, v);
+                        break;
+                default:
+                        buf[0] = i & 1 ? PROFLIGHT_SWITCHPANEL_LIGHT_N_RED
+                                        | PROFLIGHT_SWITCHPANEL_LIGHT_L_RED
+                                        | PROFLIGHT_SWITCHPANEL_LIGHT_R_RED
+                                : PROFLIGHT_SWITCHPANEL_LIGHT_N_GREEN
+                                        | PROFLIGHT_SWITCHPANEL_LIGHT_L_GREEN
+                                        | PROFLIGHT_SWITCHPANEL_LIGHT_R_GREEN;
+                }
+                return panel->feature_len;
+        case EMU_LED:
+                return snprintf(buf, size, "%u", ~i & 1);
+        }
+        return 0;
+}
+
+static void emu_bench_output(enum emu_output_source source, const char *name, const char *attr,
+                unsigned int count, unsigned int interval_us)
+{
+        char buf[PROFLIGHT_FRAME_LEN + 64];
+        __u64 *samples, t0, t1;
+        unsigned int i, n = 0, lost = 0;
+        unsigned long seen;
+        size_t len;
+        int fd;
+
+        fd = open(attr, O_WRONLY);
+        if (fd < 0) {
+                printf("%-10s %s: %s\n", name, attr, strerror(errno));
+                return;
+        }
+        samples = calloc(count, sizeof(*samples));
+        if (!samples)
+                die("calloc");
+        for (i = 0; i < count; i++) {
+                len = emu_output_buf(source, i, buf, sizeof(buf));
+                seen = emu_set_reports();
+                t0 = now_ns();
+                if (pwrite(fd, buf, len, 0) != (ssize_t)len) {
+                        printf("%-10s write %s: %s\n", name, attr, strerror(errno));
+                        break;
+                }
+                t1 = emu_wait_set_report(seen);
+                if (t1)
+                        samples[n++] = t1 - t0;
+                else
+                        lost++;
+                sleep_us(interval_us);
+        }
+        emu_report(name, samples, n, lost);
+        free(samples);
+        close(fd);
+}
+
+static int emu_write_rule(const char *attr, const struct proflight_rule *rule)
+{
+        int fd, res;
+
+        fd = open(attr, O_WRONLY);
+        if (fd < 0)
+                return -1;
+        res = pwrite(fd, rule, sizeof(*rule), 0) == sizeof(*rule) ? 0 : -1;
+        close(fd);
+        return res;
+}
+
+static void emu_bench(unsigned int count, unsigned int interval_us)
+{
+        const struct proflight_rule clear = { PROFLIGHT_EV_SYN };
+        char chardev[PATH_MAX], node[PATH_MAX], path[PATH_MAX];
+        char *name;
+
+        if (!emu_find("misc/proflight*", path, sizeof(path)))
+                return;
+        name = strrchr(path, '/') + 1;
+        snprintf(chardev, sizeof(chardev), "/dev/%s", name);
+
+        printf("%-10s %6s %6s %9s %9s %9s %9s %9s %9s\n", "us", "n", "lost",
+                        "min", "p50", "p90", "p99", "p99.9", "max");
+        emu_bench_input(EMU_CHARDEV, "chardev", chardev, count, interval_us);
+        if (emu_find("input/input*/event*", path, sizeof(path))) {
+                snprintf(node, sizeof(node), "/dev/input/%s", strrchr(path, '/') + 1);
+                emu_bench_input(EMU_EVDEV, "evdev", node, count, interval_us);
+        } else {
+                printf("%-10s no input device\n", "evdev");
+        }
+        emu_bench_input(EMU_STATE, "state", chardev, count, interval_us);
+        snprintf(path, sizeof(path), "%s/rules", hid_dir);
+        if (!emu_write_rule(path, &panel->rule)) {
+                emu_bench_input(EMU_RULES, "rules", chardev, count, interval_us);
+                emu_write_rule(path, &clear);
+        } else {
+                printf("%-10s %s: %s\n", "rules", path, strerror(errno));
+        }
+
+        snprintf(path, sizeof(path), "%s/proflight", hid_dir);
+        emu_bench_output(EMU_TEXT, "proflight", path, count, interval_us);
+        snprintf(path, sizeof(path), "%s/frame", hid_dir);
+        emu_bench_output(EMU_FRAME, "frame", path, count, interval_us);
+        if (emu_find("leds/*/brightness", path, sizeof(path)))
+                emu_bench_output(EMU_LED, "led", path, count, interval_us);
+        else
+                printf("%-10s no LED class device\n", "led");
+}
+
+/*
+ * Sends every line of 6 hex digits read from stdin as an input report.
+ */
+static void emu_interactive(void)
+{
+        char line[256];
+        unsigned int b0, b1, b2;
+
+        while (fgets(line, sizeof(line), stdin)) {
+                if (sscanf(line, "%2x%2x%2x", &b0, &b1, &b2) != 3) {
+                        fprintf(stderr, "Expected 6 hex digits (3 report bytes).\n");
+                        continue;
+                }
+                emu_input(b0 | b1 << 8 | b2 << 16);
+        }
+}
+
+static void usage(const char *argv0)
+{
+        fprintf(stderr, "Usage: %s [-p radio|multi|switch] [-l log] [-b] [-n count] "
+                        "[-i interval_us]\n", argv0);
+        exit(2);
+}
+
+int main(int argc, char **argv)
+{
+        pthread_condattr_t attr;
+        pthread_t thread;
+        unsigned int count = 1000, interval_us = 10000;
+        const char *log_path = NULL;
+        int bench = 0, opt;
+        size_t i;
+
+        panel = &emu_panels[0];
+        while ((opt = getopt(argc, argv, "p:l:bn:i:")) != -1) {
+                switch (opt) {
+                case 'p':
+                        for (i = 0; i < sizeof(emu_panels) / sizeof(emu_panels[0]); i++)
+                                if (!strcmp(optarg, emu_panels[i].name))
+                                        break;
+                        if (i == sizeof(emu_panels) / sizeof(emu_panels[0]))
+                                usage(argv[0]);
+                        panel = &emu_panels[i];
+                        break;
+                case 'l':
+                        log_path = optarg;
+                        break;
+                case 'b':
+                        bench = 1;
+                        break;
+                case 'n':
+                        count = strtoul(optarg, NULL, 0);
+                        break;
+                case 'i':
+                        interval_us = strtoul(optarg, NULL, 0);
+                        break;
+                default:
+                        usage(argv[0]);
+                }
+        }
+        if (!count)
+                usage(argv[0]);
+        if (log_path) {
+                log_file = fopen(log_path, "w");
+                if (!log_file)
+                        die(log_path);
+        } else if (!bench) {
+                log_file = stdout; // the benchmark's own output goes there
+        }
+
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&cond, &attr);
+        snprintf(uniq, sizeof(uniq), "proflight-emu-%d", (int)getpid());
+        input_bits = panel->rest;
+
+        uhid_fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+        if (uhid_fd < 0)
+                die("/dev/uhid");
+        if (pthread_create(&thread, NULL, emu_thread, NULL))
+                die("pthread_create");
+        emu_create();
+        emu_wait_bound();
+        emu_input(panel->rest);
+        fprintf(stderr, "Emulated %s panel: %s\n", panel->name, hid_dir);
+
+        if (bench)
+                emu_bench(count, interval_us);
+        else
+                emu_interactive();
+
+        emu_destroy();
+        close(uhid_fd);
+        if (log_file && log_file != stdout)
+                fclose(log_file);
+        return 0;
+}